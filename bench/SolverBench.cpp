@@ -0,0 +1,305 @@
+#include "SolverBench.h"
+#include "../src/PuzzleSolver.h"
+#include "../src/SolverService.h"
+#include "../src/TranspositionTable.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+typedef vector<pair<int, int>> CellList;
+
+// 十二块五格骨牌
+static vector<PuzzlePiece> pentominoes() {
+	return {
+		{ "F", { { 0, 1 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 2, 1 } } },
+		{ "I", { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 } } },
+		{ "L", { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 3, 1 } } },
+		{ "N", { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 2 }, { 1, 3 } } },
+		{ "P", { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 }, { 2, 0 } } },
+		{ "T", { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 2, 1 } } },
+		{ "U", { { 0, 0 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 1, 2 } } },
+		{ "V", { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 2, 1 }, { 2, 2 } } },
+		{ "W", { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 }, { 2, 2 } } },
+		{ "X", { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, 2 }, { 2, 1 } } },
+		{ "Y", { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 2, 1 }, { 3, 1 } } },
+		{ "Z", { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 2, 2 } } },
+	};
+}
+
+struct SolverCase {
+	string name;
+	Bitboard board;
+	long long solutions = -1;  // 已知的解数量（含旋转/翻转得到的解），-1 表示不枚举
+};
+
+static Bitboard makeBoard(int rows, int cols, const CellList& blocked = CellList()) {
+	Bitboard board;
+	board.rows = rows;
+	board.cols = cols;
+	board.target = rows * cols == 64 ? ~0ULL : (1ULL << (rows * cols)) - 1;
+	for (const auto& c : blocked) {
+		board.blocked |= 1ULL << board.bit(c.first, c.second);
+	}
+	return board;
+}
+
+static vector<SolverCase> solverCases() {
+	return {
+		{ "20x3", makeBoard(20, 3), 8 },
+		{ "8x8-center", makeBoard(8, 8, { { 3, 3 }, { 3, 4 }, { 4, 3 }, { 4, 4 } }), 520 },
+		{ "10x6", makeBoard(10, 6), 9356 },
+		{ "5x6", makeBoard(5, 6) },
+		{ "6x6-corner", makeBoard(6, 6, { { 0, 0 } }) },
+	};
+}
+
+static CellList normalize(CellList cells) {
+	int minRow = cells.front().first, minCol = cells.front().second;
+	for (const auto& c : cells) {
+		minRow = std::min(minRow, c.first);
+		minCol = std::min(minCol, c.second);
+	}
+	for (auto& c : cells) {
+		c.first -= minRow;
+		c.second -= minCol;
+	}
+	sort(cells.begin(), cells.end());
+	return cells;
+}
+
+// 拼图块的全部旋转/翻转
+static set<CellList> orientations(const CellList& cells) {
+	set<CellList> result;
+	CellList current = cells;
+	for (int flip = 0; flip < 2; flip++) {
+		for (int rot = 0; rot < 4; rot++) {
+			result.insert(normalize(current));
+			for (auto& c : current) {
+				c = { c.second, -c.first };
+			}
+		}
+		for (auto& c : current) {
+			c.second = -c.second;
+		}
+	}
+	return result;
+}
+
+// 放置互不重叠且都在目标格内，每块最多用一次，且每个放置是该拼图块的某个朝向；covered 返回覆盖的格子
+static bool validPlacements(const Bitboard& board, const vector<PuzzlePiece>& pieces, const PuzzleSolution& solution, uint64_t& covered) {
+	covered = 0;
+	uint64_t target = board.target & ~board.blocked;
+	vector<bool> used(pieces.size(), false);
+	for (const Placement& p : solution.placements) {
+		if (p.piece < 0 || p.piece >= static_cast<int>(pieces.size()) || used[p.piece] || (covered & p.mask) != 0 || (p.mask & ~target) != 0) {
+			return false;
+		}
+		used[p.piece] = true;
+		covered |= p.mask;
+
+		// 掩码按行拆开时不能跨行回绕，因此按格子坐标比较形状
+		CellList cells;
+		for (uint64_t m = p.mask; m; m &= m - 1) {
+			int bit = countr_zero(m);
+			cells.push_back({ bit / board.cols, bit % board.cols });
+		}
+		if (!orientations(pieces[p.piece].cells).count(normalize(cells))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 解必须恰好覆盖全部目标格
+static bool validSolution(const Bitboard& board, const vector<PuzzlePiece>& pieces, const PuzzleSolution& solution) {
+	uint64_t covered = 0;
+	return validPlacements(board, pieces, solution, covered) && covered == (board.target & ~board.blocked);
+}
+
+static vector<uint64_t> solutionKey(const PuzzleSolution& solution) {
+	vector<uint64_t> key;
+	for (const Placement& p : solution.placements) {
+		key.push_back(p.mask);
+	}
+	sort(key.begin(), key.end());
+	return key;
+}
+
+static bool checkSolutions(const string& what, const SolverCase& c, const vector<PuzzlePiece>& pieces, const vector<PuzzleSolution>& solutions) {
+	set<vector<uint64_t>> distinct;
+	for (const auto& s : solutions) {
+		if (!validSolution(c.board, pieces, s)) {
+			cerr << what << " @ " << c.name << ": invalid solution" << endl;
+			return false;
+		}
+		distinct.insert(solutionKey(s));
+	}
+	if (distinct.size() != solutions.size()) {
+		cerr << what << " @ " << c.name << ": " << solutions.size() - distinct.size() << " duplicate solutions" << endl;
+		return false;
+	}
+	return true;
+}
+
+static string nodesNote(const PuzzleSolver& solver) {
+	return "nodes=" + to_string(solver.nodes());
+}
+
+// 找第一个解：各路径是否有解必须与通用搜索一致，解必须合法
+static bool checkFirstSolution(const SolverCase& c, const vector<PuzzlePiece>& pieces, const SolverTimer& timer, int reps) {
+	bool ok = true;
+	PuzzleSolver plain(pieces);
+	plain.setFixedSizeSearch(false);
+	PuzzleSolution solution;
+	bool expected = false;
+	timer("solve.plain", c.name, reps, [&]() {
+		expected = plain.solve(c.board, solution);
+	}, [&]() { return nodesNote(plain) + " found=" + to_string(expected); });
+	if (expected && !validSolution(c.board, pieces, solution)) {
+		cerr << "solve.plain @ " << c.name << ": invalid solution" << endl;
+		ok = false;
+	}
+
+	auto compare = [&](const string& what, bool found) {
+		if (found != expected || (found && !validSolution(c.board, pieces, solution))) {
+			cerr << what << " @ " << c.name << ": found=" << found << " (plain " << expected << ")"
+				<< (found ? ", solution invalid or different outcome" : "") << endl;
+			ok = false;
+		}
+	};
+
+	PuzzleSolver fixed(pieces);
+	bool found = false;
+	if (makeBoardSearch(c.board.rows, c.board.cols)) {
+		timer("solve.board", c.name, reps, [&]() {
+			found = fixed.solve(c.board, solution);
+		}, [&]() { return nodesNote(fixed); });
+		compare("solve.board", found);
+	}
+
+	TranspositionTable table(4);
+	PuzzleSolver cached(pieces);
+	cached.setTranspositionTable(&table);
+	timer("solve.table.cold", c.name, reps, [&]() {
+		table.clear();
+		found = cached.solve(c.board, solution);
+	}, [&]() { return nodesNote(cached) + " probes=" + to_string(cached.tableProbes()) + " hits=" + to_string(cached.tableHits()); });
+	compare("solve.table.cold", found);
+	timer("solve.table.warm", c.name, reps, [&]() {
+		found = cached.solve(c.board, solution);
+	}, [&]() { return nodesNote(cached) + " probes=" + to_string(cached.tableProbes()) + " hits=" + to_string(cached.tableHits()); });
+	compare("solve.table.warm", found);
+
+	vector<PuzzleSolution> solutions;
+	PuzzleSolver parallel(pieces);
+	timer("solveParallel", c.name, reps, [&]() {
+		found = parallel.solveParallel(c.board, solutions);
+	}, [&]() { return nodesNote(parallel); });
+	solution = found ? solutions.front() : PuzzleSolution();
+	compare("solveParallel", found);
+
+	parallel.setTranspositionTable(&table);
+	timer("solveParallel.table", c.name, reps, [&]() {
+		table.clear();
+		found = parallel.solveParallel(c.board, solutions);
+	}, [&]() { return nodesNote(parallel); });
+	solution = found ? solutions.front() : PuzzleSolution();
+	compare("solveParallel.table", found);
+	return ok;
+}
+
+// 枚举全部解：串行、并行与使用置换表时的解数量都必须等于已知值
+static bool checkEnumeration(const SolverCase& c, const vector<PuzzlePiece>& pieces, const SolverTimer& timer) {
+	bool ok = true;
+	PuzzleSolver solver(pieces);
+	vector<PuzzleSolution> solutions;
+	auto enumerate = [&](const string& what, const ParallelSolveOptions& options) {
+		timer(what, c.name, 1, [&]() {
+			solver.solveParallel(c.board, solutions, options);
+		}, [&]() {
+			string note = nodesNote(solver) + " solutions=" + to_string(solutions.size());
+			if (solver.transpositionTable()) {
+				note += " probes=" + to_string(solver.tableProbes()) + " hits=" + to_string(solver.tableHits());
+			}
+			return note;
+		});
+		if (static_cast<long long>(solutions.size()) != c.solutions) {
+			cerr << what << " @ " << c.name << ": " << solutions.size() << " solutions, expected " << c.solutions << endl;
+			ok = false;
+		}
+		ok &= checkSolutions(what, c, pieces, solutions);
+	};
+
+	// splitDepth 为 0 时整棵树在一个任务内串行搜索
+	ParallelSolveOptions serial;
+	serial.findAll = true;
+	serial.splitDepth = 0;
+	serial.threads = 1;
+	enumerate("enumerate.serial", serial);
+
+	ParallelSolveOptions parallel;
+	parallel.findAll = true;
+	enumerate("enumerate.parallel", parallel);
+
+	// 置换表只用无解记录剪枝，解数量不能变
+	TranspositionTable table(16);
+	solver.setTranspositionTable(&table);
+	enumerate("enumerate.serial.table", serial);
+	table.clear();
+	enumerate("enumerate.parallel.table", parallel);
+	return ok;
+}
+
+/**
+ * 随时求解：无完整解的棋盘也要得到覆盖最多的部分放置
+ * 2x3 棋盘 B 用 L 形与 I 形三格骨牌无法铺满，最多覆盖 3 格。B 在置换表中被证明无解后，
+ * 先求解少一格的 C 再求解 B（识别结果在帧间闪烁时的情形），B 仍须得到 3 格的部分放置；
+ * 只有 I 形一块时拼图块总格数少于目标格数，同样须得到 3 格。
+ */
+static bool checkAnytime(const SolverTimer& timer) {
+	vector<PuzzlePiece> pieces = {
+		{ "L3", { { 0, 0 }, { 1, 0 }, { 1, 1 } } },
+		{ "I3", { { 0, 0 }, { 0, 1 }, { 0, 2 } } },
+	};
+	Bitboard b = makeBoard(2, 3);
+	Bitboard c = b;
+	c.target &= ~(1ULL << c.bit(1, 2));
+
+	bool ok = true;
+	SolverService service(pieces, 1);
+	AnytimeSolution result;
+	auto solve = [&](const string& what, const Bitboard& board, const vector<int>* available, int expected) {
+		timer(what, "2x3", 1, [&]() {
+			service.solveAnytime(board, chrono::steady_clock::now() + chrono::seconds(1), result, available);
+		}, [&]() { return "covered=" + to_string(result.covered) + "/" + to_string(result.target); });
+		uint64_t covered = 0;
+		if (result.covered != expected || !validPlacements(board, pieces, result.solution, covered) || popcount(covered) != result.covered) {
+			cerr << what << ": covered " << result.covered << " with " << result.solution.placements.size() << " placements, expected " << expected << endl;
+			ok = false;
+		}
+	};
+	solve("anytime.B", b, nullptr, 3);
+	solve("anytime.C", c, nullptr, 3);
+	solve("anytime.B.again", b, nullptr, 3);
+	vector<int> onlyI = { 1 };
+	solve("anytime.B.fewer_cells", b, &onlyI, 3);
+	return ok;
+}
+
+bool RunSolverChecks(const SolverTimer& timer, int reps) {
+	vector<PuzzlePiece> pieces = pentominoes();
+	bool ok = true;
+	for (const SolverCase& c : solverCases()) {
+		ok &= checkFirstSolution(c, pieces, timer, reps);
+		if (c.solutions >= 0) {
+			ok &= checkEnumeration(c, pieces, timer);
+		}
+	}
+	ok &= checkAnytime(timer);
+	return ok;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+/**
+ * @brief 求解器检查
+ * 固定的棋盘与拼图块集合（十二块五格骨牌）：
+ * 枚举全部解的棋盘检查解的数量与已知值一致，每个解都是合法的精确覆盖且互不重复；
+ * 找第一个解的各条路径（通用搜索、BoardSearch、置换表、solveParallel）与通用搜索比较是否有解，
+ * 得到的解必须合法；随时求解在无完整解的棋盘上须得到部分放置。每项的节点数与耗时通过计时回调报告。
+ */
+
+/**
+ * @brief 计时回调
+ * @param name 求解路径，例如 solve.plain
+ * @param board 棋盘名称
+ * @param reps body 的重复次数（不预热：置换表的冷/热状态由 body 自己决定）
+ * @param note 计时结束后调用，返回节点数等附加信息
+ */
+typedef std::function<void(const std::string& name, const std::string& board, int reps,
+	const std::function<void()>& body, const std::function<std::string()>& note)> SolverTimer;
+
+// 找第一个解的路径每项重复 reps 次，枚举只运行一次；任一检查失败时返回 false，原因写入 cerr
+bool RunSolverChecks(const SolverTimer& timer, int reps);
@@ -0,0 +1,100 @@
+#include "SyntheticBoard.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+// 在 3x3 小网格内随机生成一个连通的拼图块形状
+static vector<Point> randomPieceShape(RNG& rng) {
+	vector<Point> cells = { Point(rng.uniform(0, 3), rng.uniform(0, 3)) };
+	int target = rng.uniform(3, 6);
+	while (static_cast<int>(cells.size()) < target) {
+		Point base = cells[rng.uniform(0, static_cast<int>(cells.size()))];
+		static const Point dirs[4] = { Point(1, 0), Point(-1, 0), Point(0, 1), Point(0, -1) };
+		Point next = base + dirs[rng.uniform(0, 4)];
+		if (next.x < 0 || next.y < 0 || next.x > 2 || next.y > 2) {
+			continue;
+		}
+		if (find(cells.begin(), cells.end(), next) == cells.end()) {
+			cells.push_back(next);
+		}
+	}
+	return cells;
+}
+
+SyntheticBoard GenerateSyntheticBoard(const SyntheticBoardParams& params) {
+	RNG rng(params.seed);
+	SyntheticBoard board;
+	Size frameSize = params.frameSize;
+
+	// 背景：竖直方向缓慢渐变的暗色
+	board.frame.create(frameSize, CV_8UC3);
+	for (int y = 0; y < frameSize.height; y++) {
+		int v = 30 + 20 * y / frameSize.height;
+		board.frame.row(y).setTo(Scalar(v + 10, v, v));
+	}
+
+	// 网格位于画面上部居中，占高度约 55%
+	int cellSize = static_cast<int>(frameSize.height * 0.55) / params.rows;
+	Size gridSize(cellSize * params.cols, cellSize * params.rows);
+	board.gridRect = Rect((frameSize.width - gridSize.width) / 2, frameSize.height / 12, gridSize.width, gridSize.height);
+	int border = std::max(2, cellSize / 24);
+
+	// 格子：BLOCKED 为亮色，AVAILABLE 为暗色带内框
+	for (int row = 0; row < params.rows; row++) {
+		for (int col = 0; col < params.cols; col++) {
+			Rect cell(board.gridRect.x + col * cellSize, board.gridRect.y + row * cellSize, cellSize, cellSize);
+			bool blocked = rng.uniform(0.0, 1.0) < params.blockedRatio;
+			board.truth.push_back(blocked ? CellInfo::Status::BLOCKED : CellInfo::Status::AVAILABLE);
+			if (blocked) {
+				rectangle(board.frame, cell, Scalar(235, 238, 240), -1);
+				circle(board.frame, Point(cell.x + cellSize / 2, cell.y + cellSize / 2), cellSize / 10, Scalar(180, 180, 190), -1);
+			}
+			else {
+				rectangle(board.frame, cell, Scalar(80, 65, 55), -1);
+				Rect inner(cell.x + cellSize / 6, cell.y + cellSize / 6, cellSize * 2 / 3, cellSize * 2 / 3);
+				rectangle(board.frame, inner, Scalar(95, 80, 70), 1);
+			}
+			rectangle(board.frame, cell, Scalar(150, 150, 150), 1);
+		}
+	}
+	rectangle(board.frame, board.gridRect, Scalar(220, 220, 220), border);
+
+	// 托盘：网格下方一排拼图块图标
+	int iconSize = std::max(12, cellSize * 4 / 5);
+	int trayY = board.gridRect.br().y + border + cellSize / 3;
+	int spacing = iconSize / 3;
+	int trayX = spacing;
+	for (int i = 0; i < params.templateCount; i++) {
+		if (trayX + iconSize > frameSize.width || trayY + iconSize > frameSize.height) {
+			break;
+		}
+		Rect icon(trayX, trayY, iconSize, iconSize);
+		rectangle(board.frame, icon, Scalar(55, 50, 45), -1);
+
+		Scalar color(rng.uniform(60, 255), rng.uniform(60, 255), rng.uniform(60, 255));
+		int unit = iconSize / 3;
+		for (const Point& p : randomPieceShape(rng)) {
+			Rect block(icon.x + p.x * unit + 1, icon.y + p.y * unit + 1, unit - 2, unit - 2);
+			rectangle(board.frame, block, color, -1);
+		}
+
+		board.templateLocations.push_back(icon.tl());
+		trayX += iconSize + spacing;
+	}
+
+	// 模板取自加噪声之前的画面
+	for (const Point& p : board.templateLocations) {
+		board.templates.push_back(board.frame(Rect(p, Size(iconSize, iconSize))).clone());
+	}
+
+	if (params.noiseSigma > 0) {
+		Mat noise(frameSize, CV_16SC3);
+		rng.fill(noise, RNG::NORMAL, Scalar::all(0), Scalar::all(params.noiseSigma));
+		Mat noisy;
+		add(board.frame, noise, noisy, noArray(), CV_16SC3);
+		noisy.convertTo(board.frame, CV_8UC3);
+	}
+
+	return board;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../src/recognition.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 合成棋盘参数
+ * 按给定分辨率程序化绘制一帧游戏画面：带边框的网格、亮色的 BLOCKED 格与暗色的 AVAILABLE 格，
+ * 以及网格下方托盘中的若干拼图块图标（作为模板），最后叠加高斯噪声。
+ */
+struct SyntheticBoardParams {
+	cv::Size frameSize = cv::Size(1280, 720);
+	int rows = 5;
+	int cols = 6;
+	double blockedRatio = 0.3; // BLOCKED 格子比例
+	double noiseSigma = 4.0;   // 高斯噪声标准差（灰度级）
+	int templateCount = 6;     // 托盘中的拼图块图标数
+	uint64_t seed = 1;
+};
+
+struct SyntheticBoard {
+	cv::Mat frame;                          // BGR 帧
+	cv::Rect gridRect;                      // 网格外边框
+	std::vector<CellInfo::Status> truth;    // 按 id 顺序的真实格子状态
+	std::vector<cv::Mat> templates;         // 无噪声的拼图块图标
+	std::vector<cv::Point> templateLocations; // 图标在帧中的左上角
+};
+
+SyntheticBoard GenerateSyntheticBoard(const SyntheticBoardParams& params);
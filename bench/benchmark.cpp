@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "SyntheticBoard.h"
+#include "SolverBench.h"
+#include "../src/recognition.h"
+#include "../src/TemplateBank.h"
+#include "../src/HistogramEngine.h"
+#include "../src/TileIndex.h"
+#include "../src/TraceLog.h"
+#include "../src/FrameSource.h"
+#include "../src/utils.h"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * 基准测试
+ * 对每个分辨率生成一帧合成棋盘，分别测量识别相关函数的耗时，
+ * 每项先预热再重复计时，结果以 JSON 或 CSV 输出，便于与基线比较。
+ *
+ * 用法: ProjectSnowBench [--resolutions 720p,1080p,1440p,4k] [--noise 4] [--blocked 0.3]
+ *                        [--templates 6] [--warmup 3] [--reps 20] [--seed 1]
+ *                        [--format json|csv] [--output file]
+ *        ProjectSnowBench --check-allocs [--resolutions ...]
+ *        ProjectSnowBench --check-solver [--reps 20]
+ *        ProjectSnowBench --capture screen:0,0,1280,720 [--frames 60]
+ *
+ * --capture 只测量实时捕获（例如在 Xvfb 中运行，见 bench/xvfb_smoke.sh）：
+ * 连续读取 --frames 帧，检查输出为 BGR 且能直接交给模板库匹配，任一检查失败时返回非 0。
+ *
+ * 每项同时统计计时循环中平均每次调用的堆分配次数：Mat 数据经由计数的 MatAllocator，
+ * 其余（容器等）经由替换的全局 operator new。
+ *
+ * --check-allocs 检查预热后使用 RecognitionContext 的 analyzeGrid、TemplateMatch 与 Image2Hist：
+ * 每次调用的分配次数不能超过其中 OpenCV 原语（Canny、findContours、matchTemplate 等）
+ * 在预分配输出上单独运行时自身的分配次数，即识别代码本身不分配内存；超过时返回非 0。
+ *
+ * --check-solver 在固定棋盘上检查求解器（见 SolverBench.h）：解的数量与合法性，
+ * 以及置换表、BoardSearch、solveParallel 与通用搜索的结果是否一致；节点数写在 note 中，
+ * 棋盘名称写在 resolution 列。任一检查失败时返回非 0。
+ */
+
+static atomic<uint64_t> g_newCount{ 0 };
+
+void* operator new(size_t size) {
+	g_newCount.fetch_add(1, memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+// 统计 Mat 数据分配次数，实际分配交给 OpenCV 默认分配器
+class CountingMatAllocator : public MatAllocator {
+public:
+	explicit CountingMatAllocator(MatAllocator* base)
+		: m_base(base) {
+	}
+
+	UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, AccessFlag flags, UMatUsageFlags usageFlags) const override {
+		if (!data) {
+			m_count.fetch_add(1, memory_order_relaxed);
+		}
+		return m_base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+	bool allocate(UMatData* data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override {
+		return m_base->allocate(data, accessFlags, usageFlags);
+	}
+	void deallocate(UMatData* data) const override {
+		m_base->deallocate(data);
+	}
+
+	uint64_t count() const { return m_count.load(memory_order_relaxed); }
+
+private:
+	MatAllocator* m_base;
+	mutable atomic<uint64_t> m_count{ 0 };
+};
+
+static CountingMatAllocator* g_matAllocator = nullptr;
+
+struct BenchOptions {
+	vector<string> resolutions = { "720p", "1080p", "1440p", "4k" };
+	double noise = 4.0;
+	double blocked = 0.3;
+	int templates = 6;
+	int warmup = 3;
+	int reps = 20;
+	uint64_t seed = 1;
+	string format = "json";
+	string output;
+	bool checkAllocs = false;  // 只运行稳定状态分配检查
+	bool checkSolver = false;  // 只运行求解器检查
+	string capture;      // 非空时只运行捕获冒烟测试
+	int frames = 60;
+};
+
+struct BenchResult {
+	string name;
+	string resolution;
+	int reps = 0;
+	double minUs = 0;
+	double medianUs = 0;
+	double meanUs = 0;
+	double p95Us = 0;
+	double maxUs = 0;
+	double matAllocs = 0;  // 每次调用的 Mat 分配次数
+	double newAllocs = 0;  // 每次调用的 operator new 次数
+	string note; // 正确性等附加信息
+};
+
+static bool parseResolution(const string& name, Size& size) {
+	if (name == "720p") size = Size(1280, 720);
+	else if (name == "1080p") size = Size(1920, 1080);
+	else if (name == "1440p") size = Size(2560, 1440);
+	else if (name == "4k") size = Size(3840, 2160);
+	else {
+		// 也接受 WxH
+		int w = 0, h = 0;
+		char x = 0;
+		stringstream ss(name);
+		if (!(ss >> w >> x >> h) || x != 'x' || w <= 0 || h <= 0) {
+			return false;
+		}
+		size = Size(w, h);
+	}
+	return true;
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto value = [&]() -> string {
+			return i + 1 < argc ? argv[++i] : "";
+		};
+		if (arg == "--resolutions") {
+			options.resolutions.clear();
+			stringstream ss(value());
+			string item;
+			while (getline(ss, item, ',')) {
+				options.resolutions.push_back(item);
+			}
+		}
+		else if (arg == "--noise") options.noise = atof(value().c_str());
+		else if (arg == "--blocked") options.blocked = atof(value().c_str());
+		else if (arg == "--templates") options.templates = atoi(value().c_str());
+		else if (arg == "--warmup") options.warmup = atoi(value().c_str());
+		else if (arg == "--reps") options.reps = std::max(1, atoi(value().c_str()));
+		else if (arg == "--seed") options.seed = strtoull(value().c_str(), nullptr, 10);
+		else if (arg == "--format") options.format = value();
+		else if (arg == "--output") options.output = value();
+		else if (arg == "--check-allocs") options.checkAllocs = true;
+		else if (arg == "--check-solver") options.checkSolver = true;
+		else if (arg == "--capture") options.capture = value();
+		else if (arg == "--frames") options.frames = std::max(1, atoi(value().c_str()));
+		else {
+			cerr << "unknown argument: " << arg << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static BenchResult runBench(const string& name, const string& resolution, const BenchOptions& options, const function<void()>& body) {
+	for (int i = 0; i < options.warmup; i++) {
+		body();
+	}
+
+	vector<double> samples(options.reps);
+	uint64_t matBefore = g_matAllocator ? g_matAllocator->count() : 0;
+	uint64_t newBefore = g_newCount.load();
+	for (int i = 0; i < options.reps; i++) {
+		auto start = chrono::steady_clock::now();
+		body();
+		samples[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+	}
+	uint64_t matAfter = g_matAllocator ? g_matAllocator->count() : 0;
+	uint64_t newAfter = g_newCount.load();
+	sort(samples.begin(), samples.end());
+
+	BenchResult r;
+	r.name = name;
+	r.resolution = resolution;
+	r.reps = options.reps;
+	r.minUs = samples.front();
+	r.maxUs = samples.back();
+	r.medianUs = samples[samples.size() / 2];
+	r.p95Us = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+	double sum = 0;
+	for (double s : samples) {
+		sum += s;
+	}
+	r.meanUs = sum / samples.size();
+	r.matAllocs = static_cast<double>(matAfter - matBefore) / options.reps;
+	r.newAllocs = static_cast<double>(newAfter - newBefore) / options.reps;
+	return r;
+}
+
+static void writeResults(ostream& os, const vector<BenchResult>& results, const string& format) {
+	if (format == "csv") {
+		os << "name,resolution,reps,min_us,median_us,mean_us,p95_us,max_us,mat_allocs,new_allocs,note" << endl;
+		for (const auto& r : results) {
+			os << r.name << "," << r.resolution << "," << r.reps << "," << r.minUs << "," << r.medianUs << ","
+				<< r.meanUs << "," << r.p95Us << "," << r.maxUs << "," << r.matAllocs << "," << r.newAllocs << "," << r.note << endl;
+		}
+		return;
+	}
+
+	os << "[" << endl;
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& r = results[i];
+		os << "  {\"name\":\"" << r.name << "\",\"resolution\":\"" << r.resolution << "\",\"reps\":" << r.reps
+			<< ",\"min_us\":" << r.minUs << ",\"median_us\":" << r.medianUs << ",\"mean_us\":" << r.meanUs
+			<< ",\"p95_us\":" << r.p95Us << ",\"max_us\":" << r.maxUs << ",\"mat_allocs\":" << r.matAllocs
+			<< ",\"new_allocs\":" << r.newAllocs << ",\"note\":\"" << r.note << "\"}"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+	os << "]" << endl;
+}
+
+static bool writeOutput(const vector<BenchResult>& results, const BenchOptions& options) {
+	if (options.output.empty()) {
+		writeResults(cout, results, options.format);
+		return true;
+	}
+	ofstream file(options.output);
+	if (!file) {
+		cerr << "failed to open output: " << options.output << endl;
+		return false;
+	}
+	writeResults(file, results, options.format);
+	return true;
+}
+
+/**
+ * 稳定状态分配检查：body 每次调用的分配次数不能超过 floor
+ * floor 只运行 body 内部用到的 OpenCV 原语，输出写入预分配的缓冲区，其分配次数是库本身的下限
+ */
+static bool checkAllocs(const string& name, const string& resolution, const BenchOptions& options,
+	const function<void()>& body, const function<void()>& floor, vector<BenchResult>& results) {
+	BenchResult r = runBench(name, resolution, options, body);
+	BenchResult base = runBench(name + ".opencv", resolution, options, floor);
+	bool ok = r.matAllocs <= base.matAllocs && r.newAllocs <= base.newAllocs;
+	r.note = string(ok ? "ok" : "FAILED") + " opencv_mat_allocs=" + to_string(base.matAllocs) + " opencv_new_allocs=" + to_string(base.newAllocs);
+	if (!ok) {
+		cerr << name << " @ " << resolution << " allocates in steady state: mat " << r.matAllocs << " (opencv " << base.matAllocs
+			<< "), new " << r.newAllocs << " (opencv " << base.newAllocs << ")" << endl;
+	}
+	results.push_back(r);
+	return ok;
+}
+
+static bool runAllocChecks(const SyntheticBoard& board, const string& resolution, const BenchOptions& options, vector<BenchResult>& results) {
+	const Mat& frame = board.frame;
+	const Mat& templ = board.templates.front();
+	RecognitionContext context;
+	bool ok = true;
+
+	// 网格分析用到的原语：灰度、边缘、闭运算、外轮廓、分界线投影、积分图
+	Mat gray, edges, morphed, colProfile, rowProfile, sum, sqsum;
+	vector<vector<Point>> contours;
+	Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+	vector<CellInfo> cells;
+	ok &= checkAllocs("analyzeGrid.context", resolution, options, [&]() {
+		cells.clear();
+		analyzeGrid(frame, cells, context);
+	}, [&]() {
+		cvtColor(frame, gray, COLOR_BGR2GRAY);
+		Canny(gray, edges, FramePlanes::kCannyLow, FramePlanes::kCannyHigh);
+		morphologyEx(edges, morphed, MORPH_CLOSE, kernel);
+		findContours(morphed, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+		reduce(edges, colProfile, 0, REDUCE_SUM, CV_32F);
+		reduce(edges, rowProfile, 1, REDUCE_SUM, CV_32F);
+		cv::integral(gray, sum, sqsum, CV_32S, CV_64F);
+	}, results);
+
+	Mat result;
+	Point loc;
+	ok &= checkAllocs("TemplateMatch.context", resolution, options, [&]() {
+		loc = TemplateMatch(frame, templ, context);
+	}, [&]() {
+		matchTemplate(frame, templ, result, TM_CCOEFF_NORMED);
+		minMaxLoc(result, nullptr, nullptr, nullptr, &loc);
+	}, results);
+
+	// 直方图在 BGR 像素上一次遍历完成，不调用任何分配内存的原语
+	Mat crop = frame(Rect(board.templateLocations.front(), templ.size()));
+	ok &= checkAllocs("Image2Hist.context", resolution, options, [&]() {
+		Image2Hist(crop, context);
+	}, []() {}, results);
+	return ok;
+}
+
+// 实时捕获冒烟测试：捕获的画面必须是模板库可以直接匹配的 BGR 图像
+static int runCaptureSmoke(const BenchOptions& options) {
+	auto source = OpenFrameSource(options.capture);
+	if (!source) {
+		return 1;
+	}
+
+	Mat frame;
+	int failures = 0;
+	BenchOptions captureOptions = options;
+	captureOptions.reps = options.frames;
+	BenchResult r = runBench("CaptureSession.read", options.capture, captureOptions, [&]() {
+		if (!source->read(frame) || frame.empty()) {
+			failures++;
+		}
+	});
+	if (failures > 0 || frame.type() != CV_8UC3) {
+		cerr << "capture failed: " << failures << " failed reads, type " << frame.type() << endl;
+		return 1;
+	}
+
+	// 以画面中的一块作为模板，类型不一致时 matchAll 返回 false
+	Rect roi(frame.cols / 4, frame.rows / 4, std::max(1, frame.cols / 8), std::max(1, frame.rows / 8));
+	TemplateBank bank;
+	bank.add("center", frame(roi).clone());
+	vector<TemplateMatchResult> matches;
+	if (!bank.matchAll(frame, matches) || matches.size() != 1) {
+		cerr << "TemplateBank rejected the captured frame" << endl;
+		return 1;
+	}
+	r.note = "size=" + to_string(frame.cols) + "x" + to_string(frame.rows);
+	return writeOutput({ r }, options) ? 0 : 1;
+}
+
+// 求解器检查：不预热，计时结果与检查结论一起输出
+static int runSolverChecks(const BenchOptions& options) {
+	vector<BenchResult> results;
+	BenchOptions solverOptions = options;
+	solverOptions.warmup = 0;
+	bool ok = RunSolverChecks([&](const string& name, const string& board, int reps, const function<void()>& body, const function<string()>& note) {
+		solverOptions.reps = reps;
+		BenchResult r = runBench(name, board, solverOptions, body);
+		r.note = note();
+		results.push_back(r);
+	}, options.reps);
+	if (!writeOutput(results, options)) {
+		return -1;
+	}
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!parseArgs(argc, argv, options)) {
+		return -1;
+	}
+	g_debug = false;
+	if (!options.capture.empty()) {
+		return runCaptureSmoke(options);
+	}
+	if (options.checkSolver) {
+		return runSolverChecks(options);
+	}
+
+	CountingMatAllocator matAllocator(Mat::getStdAllocator());
+	Mat::setDefaultAllocator(&matAllocator);
+	g_matAllocator = &matAllocator;
+
+	vector<BenchResult> results;
+	bool allocsOk = true;
+	for (const string& resolution : options.resolutions) {
+		SyntheticBoardParams params;
+		if (!parseResolution(resolution, params.frameSize)) {
+			cerr << "invalid resolution: " << resolution << endl;
+			return -1;
+		}
+		params.noiseSigma = options.noise;
+		params.blockedRatio = options.blocked;
+		params.templateCount = options.templates;
+		params.seed = options.seed;
+		SyntheticBoard board = GenerateSyntheticBoard(params);
+		if (board.templates.empty()) {
+			cerr << "no templates generated for " << resolution << endl;
+			return -1;
+		}
+		if (options.checkAllocs) {
+			allocsOk &= runAllocChecks(board, resolution, options, results);
+			continue;
+		}
+
+		const Mat& frame = board.frame;
+		const Mat& templ = board.templates.front();
+
+		// analyzeGrid：同时检查识别结果与真实状态是否一致
+		vector<CellInfo> cells;
+		BenchResult r = runBench("analyzeGrid", resolution, options, [&]() {
+			cells.clear();
+			analyzeGrid(frame, cells);
+		});
+		int correct = 0;
+		for (size_t i = 0; i < cells.size() && i < board.truth.size(); i++) {
+			correct += cells[i].status == board.truth[i];
+		}
+		r.note = "cells_correct=" + to_string(correct) + "/" + to_string(board.truth.size());
+		results.push_back(r);
+
+		RecognitionContext context;
+		results.push_back(runBench("analyzeGrid.context", resolution, options, [&]() {
+			cells.clear();
+			analyzeGrid(frame, cells, context);
+		}));
+
+		GridTracker tracker;
+		r = runBench("GridTracker.locked", resolution, options, [&]() {
+			cells.clear();
+			tracker.analyze(frame, cells);
+		});
+		r.note = "reacquisitions=" + to_string(tracker.reacquisitions()) + " full=" + to_string(tracker.fullAnalyses());
+		results.push_back(r);
+
+		GridAnalyzer analyzer;
+		results.push_back(runBench("GridAnalyzer.steady", resolution, options, [&]() {
+			cells.clear();
+			analyzer.analyze(frame, cells);
+		}));
+
+		Point loc;
+		r = runBench("TemplateMatch", resolution, options, [&]() {
+			loc = TemplateMatch(frame, templ);
+		});
+		r.note = string("found=") + (loc == board.templateLocations.front() ? "1" : "0");
+		results.push_back(r);
+
+		results.push_back(runBench("TemplateMatch.context", resolution, options, [&]() {
+			loc = TemplateMatch(frame, templ, context);
+		}));
+
+		r = runBench("TemplateMatch.pyramid", resolution, options, [&]() {
+			loc = TemplateMatch(frame, templ, PyramidMatchParams());
+		});
+		r.note = string("found=") + (loc == board.templateLocations.front() ? "1" : "0");
+		results.push_back(r);
+
+		// 同一帧的网格分析与全部模板的金字塔匹配共享一个 FramePlanes
+		FramePlanes planes;
+		r = runBench("FramePlanes.shared", resolution, options, [&]() {
+			planes.reset(frame);
+			cells.clear();
+			analyzeGrid(planes, cells, GridLayout(), context);
+			for (const auto& t : board.templates) {
+				loc = TemplateMatch(planes, t, PyramidMatchParams());
+			}
+		});
+		r.note = "templates=" + to_string(board.templates.size());
+		results.push_back(r);
+
+		TemplateBank bank;
+		for (size_t i = 0; i < board.templates.size(); i++) {
+			bank.add("piece" + to_string(i), board.templates[i]);
+		}
+		vector<TemplateMatchResult> matches;
+		r = runBench("TemplateBank.matchAll", resolution, options, [&]() {
+			bank.matchAll(frame, matches);
+		});
+		int found = 0;
+		for (size_t i = 0; i < matches.size(); i++) {
+			found += matches[i].location == board.templateLocations[i];
+		}
+		r.note = "found=" + to_string(found) + "/" + to_string(board.templates.size());
+		results.push_back(r);
+
+		results.push_back(runBench("TemplateMatchTopK", resolution, options, [&]() {
+			TemplateMatchTopK(frame, board.templates);
+		}));
+
+		Mat crop = frame(Rect(board.templateLocations.front(), templ.size()));
+		results.push_back(runBench("Image2Hist", resolution, options, [&]() {
+			Image2Hist(crop);
+		}));
+
+		results.push_back(runBench("Image2Hist.context", resolution, options, [&]() {
+			Image2Hist(crop, context);
+		}));
+
+		Mat hist = Image2Hist(templ);
+		results.push_back(runBench("ImageHistCompare", resolution, options, [&]() {
+			ImageHistCompare(crop, hist);
+		}));
+
+		HistogramBank histBank;
+		for (size_t i = 0; i < board.templates.size(); i++) {
+			histBank.add("piece" + to_string(i), board.templates[i]);
+		}
+		HistogramMatch best;
+		r = runBench("HistogramBank.best", resolution, options, [&]() {
+			best = histBank.best(crop);
+		});
+		r.note = string("found=") + (best.index == 0 ? "1" : "0");
+		results.push_back(r);
+
+		TileIndex tiles;
+		for (size_t i = 0; i < board.templates.size(); i++) {
+			tiles.add("piece" + to_string(i), board.templates[i]);
+		}
+		TileMatch tile;
+		r = runBench("TileIndex.lookup", resolution, options, [&]() {
+			tile = tiles.lookup(crop);
+		});
+		r.note = string("found=") + (tile.index == 0 ? "1" : "0");
+		results.push_back(r);
+
+		// 追踪日志：相邻帧之间只有一个单元格变化，录制后按顺序回放
+		Mat changed = frame.clone();
+		if (!cells.empty()) {
+			rectangle(changed, cells.front().bounds, Scalar(255, 255, 255), FILLED);
+		}
+		const string tracePath = "bench_trace.snowtrace";
+		TraceWriter writer;
+		if (writer.open(tracePath)) {
+			uint64_t traceFrame = 0;
+			vector<StageTiming> timings = { { "analyze", 0 } };
+			r = runBench("TraceWriter.append", resolution, options, [&]() {
+				writer.append(traceFrame, chrono::steady_clock::now(), traceFrame % 2 ? changed : frame, true, cells, timings);
+				traceFrame++;
+			});
+			r.note = "bytes_per_frame=" + to_string(writer.bytesWritten() / std::max<uint64_t>(writer.frames(), 1))
+				+ " keyframes=" + to_string(writer.keyframes());
+			results.push_back(r);
+			writer.close();
+
+			TraceReader reader;
+			if (reader.open(tracePath) && reader.frameCount() > 0) {
+				size_t next = 0;
+				Mat replayed;
+				results.push_back(runBench("TraceReader.readFrame", resolution, options, [&]() {
+					reader.readFrame(next, replayed);
+					next = (next + 1) % reader.frameCount();
+				}));
+			}
+			reader.close();
+			std::remove(tracePath.c_str());
+		}
+	}
+
+	Mat::setDefaultAllocator(nullptr);
+	if (!writeOutput(results, options)) {
+		return -1;
+	}
+	return allocsOk ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Xvfb 下的 Linux 屏幕捕获冒烟测试
+# 启动一个虚拟显示，用 ProjectSnowBench --capture 连续捕获并检查输出格式，失败时返回非 0。
+# 用法: bench/xvfb_smoke.sh [ProjectSnowBench 路径] [显示编号]
+set -e
+
+BENCH=${1:-./ProjectSnowBench}
+DISPLAY_NUM=${2:-99}
+WIDTH=1280
+HEIGHT=720
+
+Xvfb ":$DISPLAY_NUM" -screen 0 "${WIDTH}x${HEIGHT}x24" -nolisten tcp &
+XVFB_PID=$!
+trap 'kill $XVFB_PID 2>/dev/null' EXIT
+
+# 等待服务器就绪
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	[ -e "/tmp/.X11-unix/X$DISPLAY_NUM" ] && break
+	sleep 0.5
+done
+
+DISPLAY=":$DISPLAY_NUM" "$BENCH" --capture "screen:0,0,$WIDTH,$HEIGHT" --frames 60
@@ -1,63 +1,377 @@
+#include <fstream>
 #include <iostream>
-//#include <vector>
+#include <sstream>
+#include <vector>
 #include <string>
 #include "src/recognition.h"
+#include "src/TemplateBank.h"
 #include "src/utils.h"
+#include "src/Metrics.h"
+#include "src/BatchRunner.h"
+#include "src/HistogramEngine.h"
+#include "src/TraceLog.h"
+#include "src/FrameSource.h"
+#include "src/SessionEngine.h"
+#include <chrono>
 
 using namespace std;
 using namespace cv;
 
-int main() {
+// 批处理模式: ProjectSnow --batch <目录|列表文件> [--templates a.jpg,b.jpg] [--threads N] [--in-flight N] [--output out.jsonl]
+static int runBatch(int argc, char** argv) {
+    string input, output, templates;
+    BatchOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--batch") { input = value; i++; }
+        else if (arg == "--templates") { templates = value; i++; }
+        else if (arg == "--threads") { options.threads = atoi(value.c_str()); i++; }
+        else if (arg == "--in-flight") { options.maxInFlight = atoi(value.c_str()); i++; }
+        else if (arg == "--output") { output = value; i++; }
+        else {
+            cerr << "unknown argument: " << arg << endl;
+            return -1;
+        }
+    }
+
+    TemplateBank bank;
+    stringstream names(templates);
+    string path;
+    while (getline(names, path, ',')) {
+        if (!path.empty() && bank.load(path, path) < 0) {
+            cerr << "load template failed: " << path << endl;
+            return -1;
+        }
+    }
+
+    vector<string> paths;
+    if (input.empty() || !BatchRunner::collectInputs(input, paths)) {
+        cerr << "no batch input" << endl;
+        return -1;
+    }
+
+    ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file) {
+            cerr << "failed to open output: " << output << endl;
+            return -1;
+        }
+    }
+
+    BatchRunner runner(&bank);
+    BatchStats stats;
+    bool ok = runner.run(paths, output.empty() ? cout : file, options, &stats);
+    cerr << "processed " << stats.images << " images (" << stats.failed << " failed) in "
+        << stats.seconds << " s, " << stats.imagesPerSecond << " images/s" << endl;
+    return ok ? 0 : 1;
+}
+
+// 回放模式: ProjectSnow --replay <追踪日志>
+// 按录制顺序重新识别每一帧，与记录的结果比较，并统计回放速度
+static int runReplay(const string& path) {
+    TraceReader reader;
+    if (!reader.open(path)) {
+        return -1;
+    }
+
+    GridAnalyzer analyzer;
+    Mat frame;
+    vector<CellInfo> recorded, cells;
+    TraceFrameInfo info;
+    size_t mismatches = 0;
+    int64_t firstNs = 0, lastNs = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < reader.frameCount(); i++) {
+        if (!reader.frameInfo(i, info) || !reader.readFrame(i, frame) || !reader.readCells(i, recorded)) {
+            cerr << "failed to read trace frame " << i << endl;
+            return 1;
+        }
+        if (i == 0) {
+            firstNs = info.timestampNs;
+        }
+        lastNs = info.timestampNs;
+
+        bool gridFound = !frame.empty() && analyzer.analyze(frame, cells);
+        bool same = gridFound == info.gridFound && (!gridFound || cells.size() == recorded.size());
+        for (size_t k = 0; same && gridFound && k < cells.size(); k++) {
+            same = cells[k].status == recorded[k].status && cells[k].row == recorded[k].row && cells[k].col == recorded[k].col;
+        }
+        if (!same) {
+            mismatches++;
+            cerr << "frame " << info.frameIndex << " differs from recording" << endl;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double recordedSeconds = (lastNs - firstNs) / 1e9;
+    cerr << "replayed " << reader.frameCount() << " frames in " << seconds << " s ("
+        << (seconds > 0 ? reader.frameCount() / seconds : 0) << " frames/s, recording spans " << recordedSeconds
+        << " s), " << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// 离线识别模式: ProjectSnow --source <视频|图像序列模板|追踪日志> [--step N] [--prefetch N] [--realtime] [--record out.snowtrace]
+// 对数据源的每一帧做增量网格分析，输出帧率；可同时把画面与结果录制为追踪日志
+static int runSource(int argc, char** argv) {
+    string uri, record;
+    FrameSourceOptions options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--source") { uri = value; i++; }
+        else if (arg == "--step") { options.frameStep = atoi(value.c_str()); i++; }
+        else if (arg == "--prefetch") { options.prefetch = atoi(value.c_str()); i++; }
+        else if (arg == "--realtime") { options.realtime = true; }
+        else if (arg == "--record") { record = value; i++; }
+        else {
+            cerr << "unknown argument: " << arg << endl;
+            return -1;
+        }
+    }
+
+    unique_ptr<FrameSource> source = OpenFrameSource(uri, options);
+    if (!source) {
+        return -1;
+    }
+    TraceWriter writer;
+    if (!record.empty() && !writer.open(record)) {
+        return -1;
+    }
+
+    GridAnalyzer analyzer;
+    Mat frame;
+    vector<CellInfo> cells;
+    vector<StageTiming> timings(1);
+    uint64_t frames = 0, found = 0;
+    auto start = chrono::steady_clock::now();
+    while (source->read(frame)) {
+        auto t0 = chrono::steady_clock::now();
+        bool gridFound = analyzer.analyze(frame, cells);
+        auto t1 = chrono::steady_clock::now();
+        found += gridFound;
+        if (writer.isOpen()) {
+            timings[0] = { "analyze", static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count()) };
+            writer.append(frames, t0, frame, gridFound, cells, timings);
+        }
+        frames++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "analyzed " << frames << " frames (" << found << " with grid) in " << seconds << " s, "
+        << (seconds > 0 ? frames / seconds : 0) << " frames/s" << endl;
+    return 0;
+}
+
+// 多会话模式: ProjectSnow --engine <数据源>[,<数据源>...] [--sessions N] [--templates a.jpg,b.jpg] [--threads N] [--prefetch N] [--fps F]
+// 一个进程内同时分析多个棋盘，模板只加载一次；会话数多于数据源时循环使用数据源（每个会话各自打开）
+static int runEngine(int argc, char** argv) {
+    size_t startupBytes = SessionEngine::residentBytes();
+    string uris, templates;
+    int sessions = 0;
+    EngineOptions options;
+    FrameSourceOptions sourceOptions;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--engine") { uris = value; i++; }
+        else if (arg == "--sessions") { sessions = atoi(value.c_str()); i++; }
+        else if (arg == "--templates") { templates = value; i++; }
+        else if (arg == "--threads") { options.threads = atoi(value.c_str()); i++; }
+        else if (arg == "--prefetch") { sourceOptions.prefetch = atoi(value.c_str()); i++; }
+        else if (arg == "--fps") { options.targetFps = atof(value.c_str()); i++; }
+        else {
+            cerr << "unknown argument: " << arg << endl;
+            return -1;
+        }
+    }
+
+    vector<string> sources, paths;
+    stringstream uriList(uris), templateList(templates);
+    string item;
+    while (getline(uriList, item, ',')) {
+        if (!item.empty()) {
+            sources.push_back(item);
+        }
+    }
+    while (getline(templateList, item, ',')) {
+        if (!item.empty()) {
+            paths.push_back(item);
+        }
+    }
+    if (sources.empty()) {
+        cerr << "no engine source" << endl;
+        return -1;
+    }
+
+    shared_ptr<const SharedAssets> assets = SharedAssets::load(paths);
+    if (!assets) {
+        return -1;
+    }
+    size_t loadedBytes = SessionEngine::residentBytes();
+
+    SessionEngine engine(assets, options);
+    int count = sessions > 0 ? sessions : static_cast<int>(sources.size());
+    for (int i = 0; i < count; i++) {
+        unique_ptr<FrameSource> source = OpenFrameSource(sources[i % sources.size()], sourceOptions);
+        if (!source) {
+            return -1;
+        }
+        engine.addSession(std::move(source));
+    }
+    if (!engine.start()) {
+        return -1;
+    }
+    engine.wait();
+    engine.stop();
+
+    EngineStats stats = engine.stats();
+    for (int i = 0; i < stats.sessions; i++) {
+        SessionStats s = engine.sessionStats(i);
+        cerr << "session " << i << ": " << s.frames << " frames (" << s.gridFound << " with grid), busy " << s.busyMs << " ms" << endl;
+    }
+    cerr << stats.sessions << " sessions on " << stats.threads << " threads / " << stats.cores << " cores: "
+        << stats.frames << " frames in " << stats.seconds << " s, " << stats.framesPerSecond << " frames/s, "
+        << stats.sessionsPerCore << " sessions/core at " << options.targetFps << " fps, fairness " << stats.fairness << endl;
+    // 每个棋盘一个进程时，每个进程都要承担启动、加载模板、会话本身与它的预取缓冲区的内存
+    size_t sourceBytesPerSession = stats.sessions > 0 ? stats.sourceBytes / stats.sessions : 0;
+    size_t perProcess = loadedBytes + stats.bytesPerSession + sourceBytesPerSession;
+    cerr << "sources: " << stats.sourceThreads << " prefetch threads, " << stats.sourceBytes / 1024 << " KiB prefetch buffers" << endl;
+    cerr << "memory: shared assets " << stats.sharedBytes / 1024 << " KiB, " << stats.bytesPerSession / 1024 << " KiB/session, resident "
+        << stats.residentBytes / 1024 << " KiB (one process per board: ~" << perProcess / 1024 << " KiB each, "
+        << perProcess * stats.sessions / 1024 << " KiB total; startup " << startupBytes / 1024 << " KiB)" << endl;
+    return 0;
+}
+
+static void printUsage() {
+    cerr << "usage:" << endl
+        << "  ProjectSnow" << endl
+        << "  ProjectSnow --batch <dir|list> [--templates a.jpg,b.jpg] [--threads N] [--in-flight N] [--output out.jsonl]" << endl
+        << "  ProjectSnow --replay <trace.snowtrace>" << endl
+        << "  ProjectSnow --source <video|pattern|trace> [--step N] [--prefetch N] [--realtime] [--record out.snowtrace]" << endl
+        << "  ProjectSnow --engine <source>[,<source>...] [--sessions N] [--templates a.jpg,b.jpg] [--threads N] [--prefetch N] [--fps F]" << endl
+        << "  any mode also accepts --metrics <out.json|out.csv> (needs SNOW_ENABLE_METRICS)" << endl;
+}
+
+int main(int argc, char** argv) {
+    // --metrics <path.json|.csv> 可用于任意模式，从参数中取出后再分派；默认写入 ./logs/metrics.json
+    string metricsPath = "./logs/metrics.json";
+    [[maybe_unused]] bool metricsRequested = false;
+    vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        if (string(argv[i]) == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+            metricsRequested = true;
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+#ifdef SNOW_ENABLE_METRICS
+    // 各模式直接从 main 返回，退出时写入
+    MetricsRegistry::instance().dumpAtExit(metricsPath);
+#else
+    if (metricsRequested) {
+        cerr << "--metrics ignored: built without SNOW_ENABLE_METRICS" << endl;
+    }
+#endif
+
+    if (argc > 1) {
+        // 命令行模式只输出结果，不保存调试图像
+        g_debug = false;
+        string mode = argv[1];
+        if (mode == "--batch") {
+            return runBatch(argc, argv);
+        }
+        if (mode == "--replay" && argc == 3) {
+            return runReplay(argv[2]);
+        }
+        if (mode == "--source") {
+            return runSource(argc, argv);
+        }
+        if (mode == "--engine") {
+            return runEngine(argc, argv);
+        }
+        printUsage();
+        return -1;
+    }
+
     g_debug = true;
 
     // 使用相对路径读取资源
     Mat image1 = imread("C:\\Project\\ProjectSnow\\images\\11.jpg");
     Mat image2 = imread("C:\\Project\\ProjectSnow\\images\\12.jpg");
-    Mat templ = imread("C:\\Project\\ProjectSnow\\images\\template.jpg");
-    Mat templ1 = imread("C:\\Project\\ProjectSnow\\images\\template11.jpeg");
 
-    if (image1.empty() || image2.empty() || templ.empty() || templ1.empty()) {
+    // 模板一次性加载到模板库，每帧批量匹配
+    TemplateBank bank;
+    int idxFull = bank.load("full", "C:\\Project\\ProjectSnow\\images\\template.jpg");
+    int idxTempl1 = bank.load("templ1", "C:\\Project\\ProjectSnow\\images\\template11.jpeg");
+
+    if (image1.empty() || image2.empty() || idxFull < 0 || idxTempl1 < 0) {
         cerr << "load image failed" << endl;
         return -1;
     }
+    const Mat& templ = bank.image(idxFull);
+    const Mat& templ1 = bank.image(idxTempl1);
 
     // 先为两个模板预计算直方图，供后续相似度比较
-    Mat histTempl = Image2Hist(templ);
-    Mat histTempl1 = Image2Hist(templ1);
+    HistogramBank histBank;
+    int histFull = histBank.add("full", templ);
+    int histTempl1 = histBank.add("templ1", templ1);
+    if (histFull < 0 || histTempl1 < 0) {
+        cerr << "build histogram failed" << endl;
+        return -1;
+    }
+
+    vector<TemplateMatchResult> matches1, matches2;
+    if (!bank.matchAll(image1, matches1) || !bank.matchAll(image2, matches2)) {
+        cerr << "template match failed" << endl;
+        return -1;
+    }
 
     // 1) image1 与 templ 匹配并裁剪保存
-    Point loc1_a = TemplateMatch(image1, templ);
+    Point loc1_a = matches1[idxFull].location;
     Rect roi1_a(loc1_a.x, loc1_a.y, templ.cols, templ.rows);
     Mat crop1_a = image1(roi1_a);
     saveImage(crop1_a, "match_image1_with_full.jpg", "matches");
 
     // 2) image1 与 templ1 匹配并裁剪保存
-    Point loc1_b = TemplateMatch(image1, templ1);
+    Point loc1_b = matches1[idxTempl1].location;
     Rect roi1_b(loc1_b.x, loc1_b.y, templ1.cols, templ1.rows);
     Mat crop1_b = image1(roi1_b);
     saveImage(crop1_b, "match_image1_with_templ1.jpg", "matches");
 
     // 3) image2 与 templ 匹配并裁剪保存
-    Point loc2_a = TemplateMatch(image2, templ);
+    Point loc2_a = matches2[idxFull].location;
     Rect roi2_a(loc2_a.x, loc2_a.y, templ.cols, templ.rows);
     Mat crop2_a = image2(roi2_a);
     saveImage(crop2_a, "match_image2_with_full.jpg", "matches");
 
     // 4) image2 与 templ1 匹配并裁剪保存
-    Point loc2_b = TemplateMatch(image2, templ1);
+    Point loc2_b = matches2[idxTempl1].location;
     Rect roi2_b(loc2_b.x, loc2_b.y, templ1.cols, templ1.rows);
     Mat crop2_b = image2(roi2_b);
     saveImage(crop2_b, "match_image2_with_templ1.jpg", "matches");
 
-    // 对四个裁剪结果分别与两个模板直方图比较（共8个分数）
-    double s1a_t = ImageHistCompare(crop1_a, histTempl);
-    double s1a_t1 = ImageHistCompare(crop1_a, histTempl1);
-    double s1b_t = ImageHistCompare(crop1_b, histTempl);
-    double s1b_t1 = ImageHistCompare(crop1_b, histTempl1);
-    double s2a_t = ImageHistCompare(crop2_a, histTempl);
-    double s2a_t1 = ImageHistCompare(crop2_a, histTempl1);
-    double s2b_t = ImageHistCompare(crop2_b, histTempl);
-    double s2b_t1 = ImageHistCompare(crop2_b, histTempl1);
+    // 对四个裁剪结果分别与两个模板直方图比较（共8个分数），每个裁剪只统计一次直方图
+    vector<double> d1a, d1b, d2a, d2b;
+    HsHistogram hist;
+    hist.compute(crop1_a);
+    histBank.compareAll(hist, d1a);
+    hist.compute(crop1_b);
+    histBank.compareAll(hist, d1b);
+    hist.compute(crop2_a);
+    histBank.compareAll(hist, d2a);
+    hist.compute(crop2_b);
+    histBank.compareAll(hist, d2b);
+    double s1a_t = d1a[histFull];
+    double s1a_t1 = d1a[histTempl1];
+    double s1b_t = d1b[histFull];
+    double s1b_t1 = d1b[histTempl1];
+    double s2a_t = d2a[histFull];
+    double s2a_t1 = d2a[histTempl1];
+    double s2b_t = d2b[histFull];
+    double s2b_t1 = d2b[histTempl1];
 
     cout << "image1-full crop vs full: " << s1a_t << endl;
     cout << "image1-full crop vs templ1: " << s1a_t1 << endl;
@@ -0,0 +1,205 @@
+#include "BatchRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+using namespace cv;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+// 流水线中传递的单张图像
+struct BatchItem {
+	string path;
+	Mat image;
+	bool ok = false;
+	string line;
+};
+
+static bool isImageFile(const fs::path& path) {
+	string ext = path.extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".webp" || ext == ".tif" || ext == ".tiff";
+}
+
+static void writeJsonString(ostream& os, const string& s) {
+	os << '"';
+	for (char c : s) {
+		switch (c) {
+		case '"': os << "\\\""; break;
+		case '\\': os << "\\\\"; break;
+		case '\n': os << "\\n"; break;
+		case '\r': os << "\\r"; break;
+		case '\t': os << "\\t"; break;
+		default: os << c; break;
+		}
+	}
+	os << '"';
+}
+
+static const char* statusName(CellInfo::Status status) {
+	switch (status) {
+	case CellInfo::BLOCKED: return "BLOCKED";
+	case CellInfo::AVAILABLE: return "AVAILABLE";
+	case CellInfo::FILLED: return "FILLED";
+	}
+	return "UNKNOWN";
+}
+
+// 整个文件一次读入内存再解码，避免 imread 的逐块读取
+static bool readImage(const string& path, Mat& image) {
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file) {
+		return false;
+	}
+	streamsize size = file.tellg();
+	if (size <= 0) {
+		return false;
+	}
+	vector<uchar> buffer(static_cast<size_t>(size));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
+		return false;
+	}
+	image = imdecode(buffer, IMREAD_COLOR);
+	return !image.empty();
+}
+
+BatchRunner::BatchRunner(const TemplateBank* templates)
+	: m_templates(templates) {
+}
+
+bool BatchRunner::collectInputs(const string& path, vector<string>& outPaths) {
+	error_code ec;
+	if (fs::is_directory(path, ec)) {
+		size_t first = outPaths.size();
+		for (const auto& entry : fs::directory_iterator(path, ec)) {
+			if (entry.is_regular_file(ec) && isImageFile(entry.path())) {
+				outPaths.push_back(entry.path().string());
+			}
+		}
+		if (ec) {
+			cerr << "failed to list directory: " << path << endl;
+			return false;
+		}
+		sort(outPaths.begin() + first, outPaths.end());
+		return true;
+	}
+
+	ifstream list(path);
+	if (!list) {
+		cerr << "failed to open input: " << path << endl;
+		return false;
+	}
+	string line;
+	while (getline(list, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (!line.empty()) {
+			outPaths.push_back(line);
+		}
+	}
+	return true;
+}
+
+bool BatchRunner::run(const vector<string>& paths, ostream& out, const BatchOptions& options, BatchStats* stats) const {
+	int threads = options.threads > 0 ? options.threads : static_cast<int>(std::max(1u, thread::hardware_concurrency()));
+	size_t maxInFlight = options.maxInFlight > 0 ? static_cast<size_t>(options.maxInFlight) : static_cast<size_t>(threads) * 2;
+	bool matchTemplates = options.matchTemplates && m_templates && !m_templates->empty();
+
+	uint64_t images = 0;
+	uint64_t failed = 0;
+	size_t next = 0;
+	auto start = chrono::steady_clock::now();
+	// 每个工作线程复用自己的识别缓冲区
+	tbb::enumerable_thread_specific<RecognitionContext> contexts;
+
+	tbb::task_arena arena(threads);
+	arena.execute([&]() {
+		tbb::parallel_pipeline(maxInFlight,
+			// 按顺序取下一个路径
+			tbb::make_filter<void, BatchItem>(tbb::filter_mode::serial_in_order, [&](tbb::flow_control& fc) {
+				BatchItem item;
+				if (next >= paths.size()) {
+					fc.stop();
+					return item;
+				}
+				item.path = paths[next++];
+				return item;
+			}) &
+			// 读取并解码
+			tbb::make_filter<BatchItem, BatchItem>(tbb::filter_mode::parallel, [](BatchItem item) {
+				item.ok = readImage(item.path, item.image);
+				return item;
+			}) &
+			// 识别并格式化为一行 JSON
+			tbb::make_filter<BatchItem, BatchItem>(tbb::filter_mode::parallel, [&](BatchItem item) {
+				ostringstream os;
+				os << "{\"path\":";
+				writeJsonString(os, item.path);
+				if (!item.ok) {
+					os << ",\"ok\":false}";
+					item.line = os.str();
+					return item;
+				}
+
+				vector<CellInfo> cells;
+				bool gridFound = analyzeGrid(item.image, cells, contexts.local());
+				os << ",\"ok\":true,\"width\":" << item.image.cols << ",\"height\":" << item.image.rows
+					<< ",\"grid\":" << (gridFound ? "true" : "false") << ",\"cells\":[";
+				for (size_t i = 0; i < cells.size(); i++) {
+					const CellInfo& c = cells[i];
+					os << (i ? "," : "") << "{\"id\":" << c.id << ",\"row\":" << c.row << ",\"col\":" << c.col
+						<< ",\"x\":" << c.center.x << ",\"y\":" << c.center.y
+						<< ",\"status\":\"" << statusName(c.status) << "\"}";
+				}
+				os << "]";
+
+				if (matchTemplates) {
+					vector<TemplateMatchResult> matches;
+					os << ",\"matches\":[";
+					if (m_templates->matchAll(item.image, matches)) {
+						for (size_t i = 0; i < matches.size(); i++) {
+							os << (i ? "," : "") << "{\"name\":";
+							writeJsonString(os, matches[i].name);
+							os << ",\"x\":" << matches[i].location.x << ",\"y\":" << matches[i].location.y
+								<< ",\"score\":" << matches[i].score << "}";
+						}
+					}
+					os << "]";
+				}
+				os << "}";
+				item.line = os.str();
+				item.image.release();
+				return item;
+			}) &
+			// 按输入顺序写出
+			tbb::make_filter<BatchItem, void>(tbb::filter_mode::serial_in_order, [&](const BatchItem& item) {
+				out << item.line << '\n';
+				if (item.ok) {
+					images++;
+				}
+				else {
+					failed++;
+					cerr << "failed to read image: " << item.path << endl;
+				}
+			}));
+	});
+	out.flush();
+
+	if (stats) {
+		stats->images = images;
+		stats->failed = failed;
+		stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		stats->imagesPerSecond = stats->seconds > 0 ? (images + failed) / stats->seconds : 0;
+	}
+	return failed == 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "recognition.h"
+#include "TemplateBank.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 批处理配置
+ */
+struct BatchOptions {
+	int threads = 0;          // 工作线程数，0 表示使用全部核心
+	int maxInFlight = 0;      // 同时处理中的图像数上限（限制内存占用），0 表示线程数的 2 倍
+	bool matchTemplates = true; // 模板库非空时是否输出模板匹配结果
+};
+
+/**
+ * @brief 批处理统计
+ */
+struct BatchStats {
+	uint64_t images = 0;    // 成功处理的图像数
+	uint64_t failed = 0;    // 读取或解码失败的图像数
+	double seconds = 0;     // 总耗时
+	double imagesPerSecond = 0;
+};
+
+/**
+ * @brief 离线批量识别
+ *
+ * 使用 tbb::parallel_pipeline 组成 取路径 -> 读取并解码 -> 识别 -> 输出 四级流水线：
+ * 读取解码与识别都是并行阶段，因此解码与计算在不同图像间自然重叠；
+ * 输出阶段按输入顺序串行执行，每张图像写出一行 JSON。
+ */
+class BatchRunner {
+public:
+	explicit BatchRunner(const TemplateBank* templates = nullptr);
+
+	/**
+	 * @brief 收集输入图像
+	 * @param path 目录（按文件名排序收集其中的图像文件）或列表文件（每行一个路径）
+	 * @param outPaths 输出路径列表
+	 * @return 是否成功
+	 */
+	static bool collectInputs(const std::string& path, std::vector<std::string>& outPaths);
+
+	/**
+	 * @brief 批量处理图像，每张图像向 out 写出一行 JSON
+	 * 格式: {"path":...,"ok":true,"grid":true,"cells":[{"id","row","col","x","y","status"}...],"matches":[...]}
+	 * @return 是否全部成功读取
+	 */
+	bool run(const std::vector<std::string>& paths, std::ostream& out, const BatchOptions& options, BatchStats* stats = nullptr) const;
+
+private:
+	const TemplateBank* m_templates;
+};
@@ -0,0 +1,124 @@
+#include "Board.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+// 编译期表的基本性质
+static_assert(Board<5, 6>::kFull == (1ULL << 30) - 1);
+static_assert(Board<5, 6>::neighbors(1ULL << Board<5, 6>::bit(0, 5)) == ((1ULL << Board<5, 6>::bit(0, 4)) | (1ULL << Board<5, 6>::bit(1, 5))));
+static_assert(Board<8, 8>::neighbors(1ULL << Board<8, 8>::bit(3, 3)) == ((1ULL << Board<8, 8>::bit(2, 3)) | (1ULL << Board<8, 8>::bit(4, 3))
+	| (1ULL << Board<8, 8>::bit(3, 2)) | (1ULL << Board<8, 8>::bit(3, 4))));
+static_assert(std::popcount(Board<6, 6>::kAnchors[1][2]) == 5 * 4);
+
+template <int Rows, int Cols>
+void BoardSearch<Rows, Cols>::build(const vector<vector<vector<pair<int, int>>>>& orientations) {
+	// 先统计每个最低位格子的放置数，再按格子顺序连续写入
+	vector<BoardMove> all;
+	m_shapeSize.assign(orientations.size(), 0);
+	m_minShapeSize = INT_MAX;
+	for (size_t s = 0; s < orientations.size(); s++) {
+		for (const auto& o : orientations[s]) {
+			int height = 0, width = 0;
+			for (const auto& c : o) {
+				height = std::max(height, c.first + 1);
+				width = std::max(width, c.second + 1);
+			}
+			m_shapeSize[s] = static_cast<int>(o.size());
+			if (height > Rows || width > Cols) {
+				continue;
+			}
+			uint64_t base = Geometry::shapeMask(o.data(), o.size());
+			for (uint64_t anchors = Geometry::kAnchors[height - 1][width - 1]; anchors; anchors &= anchors - 1) {
+				all.push_back({ static_cast<int>(s), base << countr_zero(anchors) });
+			}
+		}
+		m_minShapeSize = std::min(m_minShapeSize, m_shapeSize[s]);
+	}
+	if (m_minShapeSize == INT_MAX) {
+		m_minShapeSize = 1;
+	}
+
+	m_offsets.fill(0);
+	for (const BoardMove& move : all) {
+		m_offsets[countr_zero(move.mask) + 1]++;
+	}
+	for (int i = 0; i < Geometry::kCells; i++) {
+		m_offsets[i + 1] += m_offsets[i];
+	}
+	m_moves.resize(all.size());
+	array<uint32_t, Geometry::kCells + 1> next = m_offsets;
+	for (const BoardMove& move : all) {
+		m_moves[next[countr_zero(move.mask)]++] = move;
+	}
+}
+
+template <int Rows, int Cols>
+bool BoardSearch<Rows, Cols>::solve(uint64_t target, vector<int>& shapeCount, int pieceCells, vector<BoardMove>& outPath, uint64_t& nodes) const {
+	outPath.clear();
+	return search(target & Geometry::kFull, pieceCells, shapeCount.data(), outPath, nodes);
+}
+
+template <int Rows, int Cols>
+bool BoardSearch<Rows, Cols>::isolates(uint64_t remaining, uint64_t placed) const {
+	// 从放置周围的每个未覆盖格向外扩张，达到最小拼图块大小即可停止
+	uint64_t frontier = Geometry::neighbors(placed) & remaining;
+	while (frontier) {
+		uint64_t region = frontier & (~frontier + 1);
+		while (popcount(region) < m_minShapeSize) {
+			uint64_t grown = (region | Geometry::neighbors(region)) & remaining;
+			if (grown == region) {
+				return true;
+			}
+			region = grown;
+		}
+		frontier &= ~region;
+	}
+	return false;
+}
+
+template <int Rows, int Cols>
+bool BoardSearch<Rows, Cols>::search(uint64_t remaining, int pieceCells, int* shapeCount, vector<BoardMove>& path, uint64_t& nodes) const {
+	nodes++;
+	if (remaining == 0) {
+		return true;
+	}
+	if (popcount(remaining) > pieceCells) {
+		return false;
+	}
+
+	int cell = countr_zero(remaining);
+	for (uint32_t i = m_offsets[cell]; i < m_offsets[cell + 1]; i++) {
+		const BoardMove& move = m_moves[i];
+		if ((move.mask & remaining) != move.mask || shapeCount[move.shape] == 0 || isolates(remaining & ~move.mask, move.mask)) {
+			continue;
+		}
+		shapeCount[move.shape]--;
+		path.push_back(move);
+		bool found = search(remaining & ~move.mask, pieceCells - m_shapeSize[move.shape], shapeCount, path, nodes);
+		shapeCount[move.shape]++;
+		if (found) {
+			return true;
+		}
+		path.pop_back();
+	}
+	return false;
+}
+
+// 网格检测中常见的棋盘尺寸
+template class BoardSearch<5, 6>;
+template class BoardSearch<6, 6>;
+template class BoardSearch<8, 8>;
+
+unique_ptr<BoardSearchBase> makeBoardSearch(int rows, int cols) {
+	if (rows == 5 && cols == 6) {
+		return make_unique<BoardSearch<5, 6>>();
+	}
+	if (rows == 6 && cols == 6) {
+		return make_unique<BoardSearch<6, 6>>();
+	}
+	if (rows == 8 && cols == 8) {
+		return make_unique<BoardSearch<8, 8>>();
+	}
+	return nullptr;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 固定尺寸位棋盘的编译期表
+ * 格子 (row, col) 对应第 row * Cols + col 位。列掩码与
+ * 各包围盒尺寸可放置的左上角集合都是 constexpr 表；
+ * 形状以 (0, 0) 为左上角的掩码左移 anchor 位即得到放置掩码，不需要逐格计算。
+ */
+template <int Rows, int Cols>
+struct Board {
+	static_assert(Rows > 0 && Cols > 0 && Rows * Cols <= 64, "board must fit in 64 bits");
+
+	static constexpr int kRows = Rows;
+	static constexpr int kCols = Cols;
+	static constexpr int kCells = Rows * Cols;
+	static constexpr uint64_t kFull = kCells == 64 ? ~0ULL : (1ULL << kCells) - 1;
+
+	static constexpr int bit(int row, int col) { return row * Cols + col; }
+
+	static constexpr std::array<uint64_t, Cols> makeColMasks() {
+		std::array<uint64_t, Cols> masks{};
+		for (int c = 0; c < Cols; c++) {
+			for (int r = 0; r < Rows; r++) {
+				masks[c] |= 1ULL << bit(r, c);
+			}
+		}
+		return masks;
+	}
+
+	// kAnchors[h - 1][w - 1]：高 h、宽 w 的包围盒能完整放入棋盘的左上角格子
+	static constexpr std::array<std::array<uint64_t, Cols>, Rows> makeAnchors() {
+		std::array<std::array<uint64_t, Cols>, Rows> anchors{};
+		for (int h = 1; h <= Rows; h++) {
+			for (int w = 1; w <= Cols; w++) {
+				uint64_t m = 0;
+				for (int r = 0; r + h <= Rows; r++) {
+					for (int c = 0; c + w <= Cols; c++) {
+						m |= 1ULL << bit(r, c);
+					}
+				}
+				anchors[h - 1][w - 1] = m;
+			}
+		}
+		return anchors;
+	}
+
+	static constexpr std::array<uint64_t, Cols> kColMasks = makeColMasks();
+	static constexpr std::array<std::array<uint64_t, Cols>, Rows> kAnchors = makeAnchors();
+
+	// 以 (0, 0) 为左上角的形状掩码，cells 为规范化后的 (行, 列) 偏移
+	static constexpr uint64_t shapeMask(const std::pair<int, int>* cells, size_t count) {
+		uint64_t m = 0;
+		for (size_t i = 0; i < count; i++) {
+			m |= 1ULL << bit(cells[i].first, cells[i].second);
+		}
+		return m;
+	}
+
+	// 四邻域扩张一步（不含自身），只用移位与列掩码
+	static constexpr uint64_t neighbors(uint64_t mask) {
+		uint64_t east = (mask & ~kColMasks[Cols - 1]) << 1;
+		uint64_t west = (mask & ~kColMasks[0]) >> 1;
+		return (east | west | (mask << Cols) | (mask >> Cols)) & kFull;
+	}
+};
+
+// 固定尺寸搜索使用的放置
+struct BoardMove {
+	int shape;
+	uint64_t mask;
+};
+
+/**
+ * @brief 固定尺寸棋盘上的精确覆盖搜索
+ * 由 makeBoardSearch 按运行时检测到的网格尺寸选择实现，不支持的尺寸返回空指针，
+ * 调用方退回通用搜索。
+ */
+class BoardSearchBase {
+public:
+	virtual ~BoardSearchBase() = default;
+
+	/**
+	 * @brief 生成放置表
+	 * @param orientations 每种形状的所有朝向，每个朝向为规范化（平移到 (0, 0)）后的格子列表
+	 */
+	virtual void build(const std::vector<std::vector<std::vector<std::pair<int, int>>>>& orientations) = 0;
+
+	/**
+	 * @brief 找第一个解
+	 * @param shapeCount 每种形状剩余可用数量，返回时恢复原值
+	 * @param pieceCells 剩余拼图块的总格数
+	 */
+	virtual bool solve(uint64_t target, std::vector<int>& shapeCount, int pieceCells, std::vector<BoardMove>& outPath, uint64_t& nodes) const = 0;
+
+	virtual int rows() const = 0;
+	virtual int cols() const = 0;
+};
+
+/**
+ * @brief Board<Rows, Cols> 上的搜索
+ * 放置按最低位格子连续存放在同一数组中，区间由 offsets 给出；
+ * 每次放置后检查它周围的未覆盖区域是否容得下最小的拼图块，提前剪掉留下孤立小区域的分支，
+ * 区域扩张全部是编译期尺寸上的移位与掩码运算。
+ * 只对 Board.cpp 中显式实例化的尺寸可用。
+ */
+template <int Rows, int Cols>
+class BoardSearch : public BoardSearchBase {
+public:
+	typedef Board<Rows, Cols> Geometry;
+
+	void build(const std::vector<std::vector<std::vector<std::pair<int, int>>>>& orientations) override;
+	bool solve(uint64_t target, std::vector<int>& shapeCount, int pieceCells, std::vector<BoardMove>& outPath, uint64_t& nodes) const override;
+
+	int rows() const override { return Rows; }
+	int cols() const override { return Cols; }
+
+private:
+	bool search(uint64_t remaining, int pieceCells, int* shapeCount, std::vector<BoardMove>& path, uint64_t& nodes) const;
+	// 放置 placed 后，remaining 中与其相邻的连通区域是否有小于最小拼图块的
+	bool isolates(uint64_t remaining, uint64_t placed) const;
+
+	std::array<uint32_t, Geometry::kCells + 1> m_offsets{};
+	std::vector<BoardMove> m_moves;
+	std::vector<int> m_shapeSize;
+	int m_minShapeSize = 1;
+};
+
+extern template class BoardSearch<5, 6>;
+extern template class BoardSearch<6, 6>;
+extern template class BoardSearch<8, 8>;
+
+// 运行时分派：rows x cols 有对应的实例化时返回其搜索器，否则返回空指针
+std::unique_ptr<BoardSearchBase> makeBoardSearch(int rows, int cols);
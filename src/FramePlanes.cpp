@@ -0,0 +1,117 @@
+#include "FramePlanes.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+FramePlanes::FramePlanes(const Mat& frame) {
+	reset(frame);
+}
+
+void FramePlanes::reset(const Mat& frame) {
+	m_frame = frame;
+	m_valid = 0;
+	m_pyramidLevels = 0;
+}
+
+void FramePlanes::clear() {
+	// 灰度输入时 m_gray 与金字塔第 0 层直接引用帧数据
+	if (m_frame.channels() == 1) {
+		m_gray.release();
+	}
+	if (!m_pyramid.empty()) {
+		m_pyramid[0].release();
+	}
+	m_frame.release();
+	m_valid = 0;
+	m_pyramidLevels = 0;
+}
+
+const Mat& FramePlanes::gray() {
+	if (!has(GRAY)) {
+		SNOW_SCOPED_TIMER("FramePlanes.gray");
+		if (m_frame.channels() == 1) {
+			m_gray = m_frame;
+		}
+		else {
+			cvtColor(m_frame, m_gray, m_frame.channels() == 4 ? COLOR_BGRA2GRAY : COLOR_BGR2GRAY);
+		}
+		m_valid |= GRAY;
+	}
+	return m_gray;
+}
+
+const Mat& FramePlanes::hsv() {
+	if (!has(HSV)) {
+		SNOW_SCOPED_TIMER("FramePlanes.hsv");
+		if (m_frame.channels() == 4) {
+			// BGRA 没有直接到 HSV 的转换，借用 m_hsv 作为中间结果
+			cvtColor(m_frame, m_hsv, COLOR_BGRA2BGR);
+			cvtColor(m_hsv, m_hsv, COLOR_BGR2HSV);
+		}
+		else {
+			cvtColor(m_frame, m_hsv, COLOR_BGR2HSV);
+		}
+		m_valid |= HSV;
+	}
+	return m_hsv;
+}
+
+const Mat& FramePlanes::edges() {
+	if (!has(EDGES)) {
+		const Mat& g = gray();
+		SNOW_SCOPED_TIMER("FramePlanes.edges");
+		Canny(g, m_edges, kCannyLow, kCannyHigh);
+		m_valid |= EDGES;
+	}
+	return m_edges;
+}
+
+const Mat& FramePlanes::integralSum() {
+	if (!has(INTEGRAL)) {
+		const Mat& g = gray();
+		SNOW_SCOPED_TIMER("FramePlanes.integral");
+		// 整帧求和在 4K 以上可能超出 32 位整数范围，统一使用双精度
+		cv::integral(g, m_sum, m_sqsum, CV_64F, CV_64F);
+		m_valid |= INTEGRAL;
+	}
+	return m_sum;
+}
+
+const Mat& FramePlanes::integralSqSum() {
+	integralSum();
+	return m_sqsum;
+}
+
+const Mat& FramePlanes::pyramid(int level) {
+	level = std::max(level, 0);
+	if (static_cast<int>(m_pyramid.size()) <= level) {
+		m_pyramid.resize(level + 1);
+	}
+	if (m_pyramidLevels == 0) {
+		m_pyramid[0] = m_frame;
+		m_pyramidLevels = 1;
+	}
+	for (; m_pyramidLevels <= level; m_pyramidLevels++) {
+		SNOW_SCOPED_TIMER("FramePlanes.pyrDown");
+		pyrDown(m_pyramid[m_pyramidLevels - 1], m_pyramid[m_pyramidLevels]);
+	}
+	return m_pyramid[level];
+}
+
+void FramePlanes::meanStdDev(const Rect& rect, double& mean, double& stddev) {
+	const Mat& sum = integralSum();
+	const Mat& sqsum = m_sqsum;
+	Rect r = rect & Rect(0, 0, m_frame.cols, m_frame.rows);
+	if (r.empty()) {
+		mean = stddev = 0;
+		return;
+	}
+	int x0 = r.x, y0 = r.y, x1 = r.br().x, y1 = r.br().y;
+	double area = static_cast<double>(r.area());
+	mean = (sum.at<double>(y1, x1) - sum.at<double>(y1, x0) - sum.at<double>(y0, x1) + sum.at<double>(y0, x0)) / area;
+	double sq = (sqsum.at<double>(y1, x1) - sqsum.at<double>(y1, x0) - sqsum.at<double>(y0, x1) + sqsum.at<double>(y0, x0)) / area;
+	stddev = std::sqrt(std::max(sq - mean * mean, 0.0));
+}
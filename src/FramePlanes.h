@@ -0,0 +1,62 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * @brief 单帧派生图像缓存
+ *
+ * 灰度图、HSV、灰度积分图、金字塔各层与边缘图在第一次请求时计算并缓存，
+ * 同一帧内的后续请求直接返回，多个识别函数共享同一实例时每种转换每帧最多执行一次。
+ * 跨帧复用同一实例时用 reset 切换到新帧，已有缓冲区保留，尺寸不变时不重新分配。
+ * 返回的引用在下一次 reset/clear 之前有效。不是线程安全的。
+ */
+class FramePlanes {
+public:
+	enum Plane {
+		GRAY = 1 << 0,
+		HSV = 1 << 1,
+		EDGES = 1 << 2,
+		INTEGRAL = 1 << 3
+	};
+
+	static constexpr double kCannyLow = 50;
+	static constexpr double kCannyHigh = 150;
+
+	FramePlanes() = default;
+	explicit FramePlanes(const cv::Mat& frame);
+
+	// 切换到新帧（BGR、BGRA 或灰度 8 位图像），之前的缓存全部失效
+	void reset(const cv::Mat& frame);
+	// 释放对帧数据的引用（例如帧来自需要回收的环形缓冲区），派生缓冲区保留
+	void clear();
+
+	const cv::Mat& frame() const { return m_frame; }
+	bool empty() const { return m_frame.empty(); }
+	// 某个平面是否已经计算过，调用方可以据此决定是否值得使用整帧平面
+	bool has(Plane plane) const { return (m_valid & plane) != 0; }
+
+	const cv::Mat& gray();
+	const cv::Mat& hsv();
+	// Canny(gray, kCannyLow, kCannyHigh)，与 analyzeGrid 定位网格使用的边缘图一致
+	const cv::Mat& edges();
+	// 灰度积分图与平方积分图，均为 CV_64F，尺寸为 (rows + 1) x (cols + 1)
+	const cv::Mat& integralSum();
+	const cv::Mat& integralSqSum();
+	// 金字塔第 level 层，0 为原帧，之后每层由上一层 pyrDown 得到
+	const cv::Mat& pyramid(int level);
+
+	// 由积分图求 rect（帧坐标）内灰度的均值与标准差
+	void meanStdDev(const cv::Rect& rect, double& mean, double& stddev);
+
+private:
+	cv::Mat m_frame;
+	cv::Mat m_gray;
+	cv::Mat m_hsv;
+	cv::Mat m_edges;
+	cv::Mat m_sum;
+	cv::Mat m_sqsum;
+	std::vector<cv::Mat> m_pyramid;
+	int m_pyramidLevels = 0;     // m_pyramid 中对当前帧有效的层数
+	unsigned m_valid = 0;
+};
@@ -0,0 +1,322 @@
+#include "FrameSource.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+bool FrameSource::skip(int count) {
+	Mat scratch;
+	for (int i = 0; i < count; i++) {
+		if (!read(scratch)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+WindowFrameSource::WindowFrameSource(string windowName)
+	: m_windowName(std::move(windowName)) {
+}
+
+// frame 仍被别处引用（例如调试图像写入队列共享了上一帧）时不能原地覆盖，改用新缓冲区
+static void detachShared(Mat& frame) {
+	if (frame.u && frame.u->refcount > 1) {
+		frame.release();
+	}
+}
+
+bool WindowFrameSource::read(Mat& frame) {
+	detachShared(frame);
+	return CaptureGameWindow(m_windowName, frame);
+}
+
+bool CaptureSessionFrameSource::openRegion(int x, int y, int width, int height) {
+	return m_session.open(x, y, width, height);
+}
+
+bool CaptureSessionFrameSource::openWindow(void* hwnd) {
+	return m_session.openWindow(hwnd);
+}
+
+bool CaptureSessionFrameSource::read(Mat& frame) {
+	if (!m_session.grab(m_view)) {
+		return false;
+	}
+	detachShared(frame);
+	cvtColor(m_view, frame, COLOR_BGRA2BGR);
+	return true;
+}
+
+bool VideoFileFrameSource::open(const string& path) {
+	m_finished = false;
+	if (!m_capture.open(path)) {
+		cerr << "failed to open video: " << path << endl;
+		return false;
+	}
+	m_fps = m_capture.get(CAP_PROP_FPS);
+	return true;
+}
+
+bool VideoFileFrameSource::read(Mat& frame) {
+	SNOW_SCOPED_TIMER("VideoFileFrameSource.read");
+	if (m_finished || !m_capture.read(frame) || frame.empty()) {
+		m_finished = true;
+		return false;
+	}
+	return true;
+}
+
+bool VideoFileFrameSource::skip(int count) {
+	for (int i = 0; i < count; i++) {
+		if (m_finished || !m_capture.grab()) {
+			m_finished = true;
+			return false;
+		}
+	}
+	return true;
+}
+
+string ImageSequenceFrameSource::path(int index) const {
+	vector<char> buffer(m_pattern.size() + 32);
+	snprintf(buffer.data(), buffer.size(), m_pattern.c_str(), index);
+	return buffer.data();
+}
+
+bool ImageSequenceFrameSource::open(const string& pattern, int first) {
+	m_pattern = pattern;
+	m_finished = false;
+	if (first < 0) {
+		first = filesystem::exists(path(0)) ? 0 : 1;
+	}
+	m_next = first;
+	if (!filesystem::exists(path(first))) {
+		cerr << "image sequence is empty: " << pattern << endl;
+		m_finished = true;
+		return false;
+	}
+	return true;
+}
+
+bool ImageSequenceFrameSource::read(Mat& frame) {
+	SNOW_SCOPED_TIMER("ImageSequenceFrameSource.read");
+	if (m_finished) {
+		return false;
+	}
+	ifstream file(path(m_next), ios::binary | ios::ate);
+	streamsize size = file ? static_cast<streamsize>(file.tellg()) : 0;
+	if (size <= 0) {
+		m_finished = true;
+		return false;
+	}
+	m_buffer.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(m_buffer.data()), size)) {
+		m_finished = true;
+		return false;
+	}
+	// 解码到 frame 已有的缓冲区
+	if (imdecode(m_buffer, IMREAD_COLOR, &frame).empty()) {
+		cerr << "failed to decode: " << path(m_next) << endl;
+		m_finished = true;
+		return false;
+	}
+	m_next++;
+	return true;
+}
+
+bool ImageSequenceFrameSource::skip(int count) {
+	m_next += std::max(count, 0);
+	return true;
+}
+
+bool TraceFrameSource::open(const string& path) {
+	m_next = 0;
+	return m_reader.open(path);
+}
+
+bool TraceFrameSource::read(Mat& frame) {
+	if (m_next >= m_reader.frameCount()) {
+		return false;
+	}
+	return m_reader.readFrame(m_next++, frame);
+}
+
+bool TraceFrameSource::skip(int count) {
+	m_next = std::min(m_reader.frameCount(), m_next + static_cast<size_t>(std::max(count, 0)));
+	return m_next < m_reader.frameCount();
+}
+
+PrefetchFrameSource::PrefetchFrameSource(unique_ptr<FrameSource> source, const FrameSourceOptions& options)
+	: m_source(std::move(source)), m_options(options) {
+	m_options.prefetch = std::max(m_options.prefetch, 2);
+	m_options.frameStep = std::max(m_options.frameStep, 1);
+	if (m_options.fps <= 0) {
+		m_options.fps = m_source->fps() > 0 ? m_source->fps() : 30.0;
+	}
+	m_slots.resize(m_options.prefetch);
+	for (int i = 0; i < m_options.prefetch; i++) {
+		m_free.push_back(i);
+	}
+	m_thread = thread(&PrefetchFrameSource::decodeLoop, this);
+}
+
+PrefetchFrameSource::~PrefetchFrameSource() {
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wakeDecoder.notify_all();
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void PrefetchFrameSource::decodeLoop() {
+	bool first = true;
+	while (true) {
+		int slot;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_wakeDecoder.wait(lock, [this]() { return !m_free.empty() || m_stopping; });
+			if (m_stopping) {
+				return;
+			}
+			slot = m_free.front();
+			m_free.pop_front();
+		}
+
+		// 槽位仍被调用方保存的帧引用时不能覆盖，改用新缓冲区
+		Mat& target = m_slots[slot];
+		if (target.u && target.u->refcount > 1) {
+			target.release();
+		}
+
+		bool ok = first || m_options.frameStep == 1 || m_source->skip(m_options.frameStep - 1);
+		first = false;
+		if (ok && m_source->sharesBuffer()) {
+			ok = m_source->read(m_view);
+			if (ok) {
+				m_view.copyTo(target);
+			}
+		}
+		else if (ok) {
+			ok = m_source->read(target);
+		}
+
+		// 槽位头只由后台线程写入，这里读取其他槽位不会与调用方冲突
+		size_t bytes = 0;
+		for (const Mat& buffer : m_slots) {
+			bytes += buffer.total() * buffer.elemSize();
+		}
+		m_bufferBytes.store(bytes, memory_order_relaxed);
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			if (ok) {
+				m_ready.push_back(slot);
+			}
+			else {
+				m_free.push_back(slot);
+				m_ended = true;
+			}
+		}
+		m_wakeReader.notify_one();
+		if (!ok) {
+			return;
+		}
+	}
+}
+
+bool PrefetchFrameSource::read(Mat& frame) {
+	SNOW_SCOPED_TIMER("PrefetchFrameSource.read");
+	{
+		unique_lock<mutex> lock(m_mutex);
+		if (m_held >= 0) {
+			// 调用方手中的上一帧就是该槽位时先释放引用，槽位可以原地复用
+			if (frame.data == m_slots[m_held].data) {
+				frame.release();
+			}
+			m_free.push_back(m_held);
+			m_held = -1;
+			m_wakeDecoder.notify_one();
+		}
+		m_wakeReader.wait(lock, [this]() { return !m_ready.empty() || m_ended; });
+		if (m_ready.empty()) {
+			frame.release();
+			return false;
+		}
+		m_held = m_ready.front();
+		m_ready.pop_front();
+		frame = m_slots[m_held];
+	}
+
+	// 实时节奏：第 n 帧在开始后 n * frameStep / fps 秒输出
+	auto now = chrono::steady_clock::now();
+	if (m_delivered == 0) {
+		m_start = now;
+	}
+	else if (m_options.realtime) {
+		auto due = m_start + chrono::duration_cast<chrono::steady_clock::duration>(
+			chrono::duration<double>(m_delivered * m_options.frameStep / m_options.fps));
+		if (due > now) {
+			this_thread::sleep_until(due);
+		}
+	}
+	m_delivered++;
+	return true;
+}
+
+bool PrefetchFrameSource::finished() const {
+	lock_guard<mutex> lock(m_mutex);
+	return m_ended && m_ready.empty();
+}
+
+static bool endsWith(const string& s, const string& suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+unique_ptr<FrameSource> OpenFrameSource(const string& uri, const FrameSourceOptions& options) {
+	// 实时捕获
+	if (uri.rfind("window:", 0) == 0) {
+		return make_unique<WindowFrameSource>(uri.substr(7));
+	}
+	if (uri.rfind("screen:", 0) == 0) {
+		int x, y, width, height;
+		auto source = make_unique<CaptureSessionFrameSource>();
+		if (sscanf(uri.c_str() + 7, "%d,%d,%d,%d", &x, &y, &width, &height) != 4 || !source->openRegion(x, y, width, height)) {
+			cerr << "failed to open screen region: " << uri << endl;
+			return nullptr;
+		}
+		return source;
+	}
+
+	// 离线数据源
+	unique_ptr<FrameSource> source;
+	if (endsWith(uri, ".snowtrace")) {
+		auto trace = make_unique<TraceFrameSource>();
+		if (!trace->open(uri)) {
+			return nullptr;
+		}
+		source = std::move(trace);
+	}
+	else if (uri.find('%') != string::npos) {
+		auto sequence = make_unique<ImageSequenceFrameSource>();
+		if (!sequence->open(uri)) {
+			return nullptr;
+		}
+		source = std::move(sequence);
+	}
+	else {
+		auto video = make_unique<VideoFileFrameSource>();
+		if (!video->open(uri)) {
+			return nullptr;
+		}
+		source = std::move(video);
+	}
+	return make_unique<PrefetchFrameSource>(std::move(source), options);
+}
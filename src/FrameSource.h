@@ -0,0 +1,207 @@
+#pragma once
+
+#include "ScreenCapture.h"
+#include "TraceLog.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 帧数据源
+ * 实时捕获与离线回放（视频文件、编号图像序列、追踪日志）共用的接口，
+ * 识别代码与 Pipeline 不关心帧从哪里来。实现只能在单个线程中使用。
+ */
+class FrameSource {
+public:
+	virtual ~FrameSource() = default;
+
+	/**
+	 * @brief 读取下一帧
+	 * @param frame 输出图像；实现尽量写入 frame 已有的缓冲区，尺寸不变时不重新分配
+	 * @return 是否读到新帧；离线数据源读完后返回 false 且 finished() 为 true
+	 */
+	virtual bool read(cv::Mat& frame) = 0;
+
+	// 跳过 count 帧，实现尽量不解码被跳过的帧
+	virtual bool skip(int count);
+
+	// 离线数据源是否已经读完；实时捕获始终为 false
+	virtual bool finished() const { return false; }
+
+	// read 输出的 Mat 是否引用数据源内部缓冲区（下一次 read 时被覆盖），长期保存前需要拷贝
+	virtual bool sharesBuffer() const { return false; }
+
+	// 数据源自身的帧率，未知时为 0
+	virtual double fps() const { return 0; }
+
+	// 数据源自带的后台线程数与缓冲区字节数（例如预取），可在其他线程调用
+	virtual int backgroundThreads() const { return 0; }
+	virtual size_t bufferBytes() const { return 0; }
+};
+
+/**
+ * @brief 按窗口名称捕获（每帧调用 CaptureGameWindow）
+ */
+class WindowFrameSource : public FrameSource {
+public:
+	explicit WindowFrameSource(std::string windowName);
+	bool read(cv::Mat& frame) override;
+
+private:
+	std::string m_windowName;
+};
+
+/**
+ * @brief 基于 CaptureSession 的屏幕区域或窗口捕获
+ * 会话缓冲区为 BGRA，read 把它转换为 BGR 写入 frame 已有的缓冲区，
+ * 与文件数据源和模板库的图像类型一致；尺寸不变时每帧不分配内存。
+ */
+class CaptureSessionFrameSource : public FrameSource {
+public:
+	bool openRegion(int x, int y, int width, int height);
+	bool openWindow(void* hwnd);
+
+	bool read(cv::Mat& frame) override;
+
+private:
+	CaptureSession m_session;
+	cv::Mat m_view;  // 会话缓冲区上的 BGRA 视图
+};
+
+/**
+ * @brief 视频文件（cv::VideoCapture）
+ * 跳帧只调用 grab，不做解码后的颜色转换与拷贝。
+ */
+class VideoFileFrameSource : public FrameSource {
+public:
+	bool open(const std::string& path);
+
+	bool read(cv::Mat& frame) override;
+	bool skip(int count) override;
+	bool finished() const override { return m_finished; }
+	double fps() const override { return m_fps; }
+
+private:
+	cv::VideoCapture m_capture;
+	double m_fps = 0;
+	bool m_finished = false;
+};
+
+/**
+ * @brief 编号图像序列，如 "frames/%06d.png"
+ * 读取文件内容后用 imdecode 解码到已有缓冲区；跳帧只移动序号，不读取文件。
+ * 遇到第一个不存在的编号时结束。
+ */
+class ImageSequenceFrameSource : public FrameSource {
+public:
+	/**
+	 * @param pattern printf 风格的路径模板，包含一个整数占位符
+	 * @param first 第一帧的编号，小于 0 时依次尝试 0 和 1
+	 */
+	bool open(const std::string& pattern, int first = -1);
+
+	bool read(cv::Mat& frame) override;
+	bool skip(int count) override;
+	bool finished() const override { return m_finished; }
+
+private:
+	std::string path(int index) const;
+
+	std::string m_pattern;
+	int m_next = 0;
+	bool m_finished = false;
+	std::vector<unsigned char> m_buffer;
+};
+
+/**
+ * @brief 追踪日志（TraceWriter 录制的 .snowtrace）中的画面
+ */
+class TraceFrameSource : public FrameSource {
+public:
+	bool open(const std::string& path);
+
+	bool read(cv::Mat& frame) override;
+	bool skip(int count) override;
+	bool finished() const override { return m_next >= m_reader.frameCount(); }
+	bool sharesBuffer() const override { return true; }
+
+	// 最近一次 read 的帧在日志中的序号，可用于读取记录的识别结果
+	size_t lastIndex() const { return m_next - 1; }
+	const TraceReader& reader() const { return m_reader; }
+
+private:
+	TraceReader m_reader;
+	size_t m_next = 0;
+};
+
+// 预取与节奏参数
+struct FrameSourceOptions {
+	int prefetch = 4;        // 环形缓冲区中的帧数，后台线程最多提前解码 prefetch - 1 帧
+	int frameStep = 1;       // 每 frameStep 帧输出一帧，其余在后台线程跳过
+	bool realtime = false;   // false 时尽快输出；true 时按帧率节奏输出
+	double fps = 0;          // realtime 时的帧率，0 使用数据源自身帧率（未知时按 30）
+};
+
+/**
+ * @brief 后台预取
+ *
+ * 后台线程从内部数据源解码到预先分配的环形缓冲区，调用线程的 read 只取出已解码的帧。
+ * read 输出的 Mat 与环形缓冲区的槽位共享数据；槽位回收时若仍被外部引用（例如在 Pipeline 队列中），
+ * 后台线程改用新的缓冲区，因此输出的帧可以直接长期保存。
+ */
+class PrefetchFrameSource : public FrameSource {
+public:
+	PrefetchFrameSource(std::unique_ptr<FrameSource> source, const FrameSourceOptions& options = FrameSourceOptions());
+	~PrefetchFrameSource() override;
+
+	PrefetchFrameSource(const PrefetchFrameSource&) = delete;
+	PrefetchFrameSource& operator=(const PrefetchFrameSource&) = delete;
+
+	bool read(cv::Mat& frame) override;
+	bool finished() const override;
+	double fps() const override { return m_source->fps(); }
+	int backgroundThreads() const override { return 1; }
+	size_t bufferBytes() const override { return m_bufferBytes.load(std::memory_order_relaxed); }
+
+private:
+	void decodeLoop();
+
+	std::unique_ptr<FrameSource> m_source;
+	FrameSourceOptions m_options;
+	std::vector<cv::Mat> m_slots;
+	cv::Mat m_view;                 // 内部数据源共享缓冲区时的中转视图
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wakeDecoder;
+	std::condition_variable m_wakeReader;
+	std::deque<int> m_free;         // 可写入的槽位
+	std::deque<int> m_ready;        // 已解码、按顺序等待读取的槽位
+	int m_held = -1;                // 调用方当前持有的槽位
+	bool m_ended = false;           // 内部数据源已读完或失败
+	bool m_stopping = false;
+	std::thread m_thread;
+	std::atomic<size_t> m_bufferBytes{ 0 };  // 环形缓冲区各槽位的字节数之和，由后台线程更新
+
+	uint64_t m_delivered = 0;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @brief 按描述打开数据源
+ * @param uri 以下形式之一：
+ *            window:<窗口名称>
+ *            screen:<x>,<y>,<宽>,<高>
+ *            包含 % 的路径：编号图像序列
+ *            .snowtrace 文件：追踪日志
+ *            其他路径：视频文件
+ * @return 失败返回空指针。离线数据源包装在 PrefetchFrameSource 中；实时捕获忽略 options
+ */
+std::unique_ptr<FrameSource> OpenFrameSource(const std::string& uri, const FrameSourceOptions& options = FrameSourceOptions());
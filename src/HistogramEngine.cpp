@@ -0,0 +1,247 @@
+#include "HistogramEngine.h"
+#include "Metrics.h"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// cvtColor(COLOR_BGR2HSV) 8 位定点实现所用的除法表，以及 calcHist 的分箱表
+struct HsvTables {
+	static constexpr int kShift = 12;
+	int sdiv[256];
+	int hdiv[256];
+	uint16_t hueBin[256];
+	uint16_t satBin[256];
+
+	HsvTables() {
+		sdiv[0] = hdiv[0] = 0;
+		for (int i = 1; i < 256; i++) {
+			sdiv[i] = saturate_cast<int>((255 << kShift) / (1. * i));
+			hdiv[i] = saturate_cast<int>((180 << kShift) / (6. * i));
+		}
+		// calcHist 均匀分箱：idx = floor(v * bins / (high - low))
+		for (int v = 0; v < 256; v++) {
+			hueBin[v] = static_cast<uint16_t>(std::min(HsHistogram::kHueBins - 1, cvFloor(v * (HsHistogram::kHueBins / 180.0))));
+			satBin[v] = static_cast<uint16_t>(cvFloor(v * (HsHistogram::kSatBins / 256.0)));
+		}
+	}
+};
+
+const HsvTables& hsvTables() {
+	static const HsvTables tables;
+	return tables;
+}
+
+// 四路累加的点积，便于编译器并行化
+float dot(const float* a, const float* b, int n) {
+	float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		s0 += a[i] * b[i];
+		s1 += a[i + 1] * b[i + 1];
+		s2 += a[i + 2] * b[i + 2];
+		s3 += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; i++) {
+		s0 += a[i] * b[i];
+	}
+	return (s0 + s1) + (s2 + s3);
+}
+
+}
+
+HsHistogram::HsHistogram() {
+	m_sqrt.fill(0.0f);
+	m_suffixMass.fill(0.0f);
+}
+
+bool HsHistogram::compute(const Mat& image) {
+	SNOW_SCOPED_TIMER("HsHistogram.compute");
+	if (image.empty() || image.depth() != CV_8U || (image.channels() != 3 && image.channels() != 4)) {
+		cerr << "HsHistogram requires a BGR/BGRA 8-bit image" << endl;
+		return false;
+	}
+
+	const HsvTables& t = hsvTables();
+	const int round = 1 << (HsvTables::kShift - 1);
+	const int cn = image.channels();
+	array<uint32_t, kBins> counts;
+	counts.fill(0);
+
+	for (int y = 0; y < image.rows; y++) {
+		const uchar* p = image.ptr<uchar>(y);
+		for (int x = 0; x < image.cols; x++, p += cn) {
+			int b = p[0], g = p[1], r = p[2];
+			int v = std::max(b, std::max(g, r));
+			int vmin = std::min(b, std::min(g, r));
+			int diff = v - vmin;
+			int vr = v == r ? -1 : 0;
+			int vg = v == g ? -1 : 0;
+
+			int s = (diff * t.sdiv[v] + round) >> HsvTables::kShift;
+			int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+			h = (h * t.hdiv[diff] + round) >> HsvTables::kShift;
+			h += h < 0 ? 180 : 0;
+
+			counts[t.hueBin[h] * kSatBins + t.satBin[s]]++;
+		}
+	}
+
+	float scale = 1.0f / static_cast<float>(image.total());
+	for (int i = 0; i < kBins; i++) {
+		m_sqrt[i] = std::sqrt(counts[i] * scale);
+	}
+	finalize();
+	return true;
+}
+
+bool HsHistogram::computeHsv(const Mat& hsv) {
+	SNOW_SCOPED_TIMER("HsHistogram.computeHsv");
+	if (hsv.empty() || hsv.type() != CV_8UC3) {
+		cerr << "HsHistogram requires an 8-bit HSV image" << endl;
+		return false;
+	}
+
+	const HsvTables& t = hsvTables();
+	array<uint32_t, kBins> counts;
+	counts.fill(0);
+
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar* p = hsv.ptr<uchar>(y);
+		for (int x = 0; x < hsv.cols; x++, p += 3) {
+			counts[t.hueBin[p[0]] * kSatBins + t.satBin[p[1]]]++;
+		}
+	}
+
+	float scale = 1.0f / static_cast<float>(hsv.total());
+	for (int i = 0; i < kBins; i++) {
+		m_sqrt[i] = std::sqrt(counts[i] * scale);
+	}
+	finalize();
+	return true;
+}
+
+bool HsHistogram::assign(const Mat& hist) {
+	if (hist.type() != CV_32F || hist.total() != static_cast<size_t>(kBins) || !hist.isContinuous()) {
+		cerr << "HsHistogram requires a 50x60 CV_32F histogram" << endl;
+		return false;
+	}
+	const float* p = hist.ptr<float>();
+	double sum = 0;
+	for (int i = 0; i < kBins; i++) {
+		sum += p[i];
+	}
+	if (sum <= 0) {
+		m_sqrt.fill(0.0f);
+		m_suffixMass.fill(0.0f);
+		m_empty = true;
+		return true;
+	}
+	for (int i = 0; i < kBins; i++) {
+		m_sqrt[i] = static_cast<float>(std::sqrt(std::max(0.0, p[i] / sum)));
+	}
+	finalize();
+	return true;
+}
+
+void HsHistogram::finalize() {
+	m_suffixMass[kChunks] = 0.0f;
+	for (int k = kChunks - 1; k >= 0; k--) {
+		const float* chunk = m_sqrt.data() + k * kChunkSize;
+		m_suffixMass[k] = m_suffixMass[k + 1] + dot(chunk, chunk, kChunkSize);
+	}
+	m_empty = m_suffixMass[0] <= 0.0f;
+}
+
+double HsHistogram::bhattacharyya(const HsHistogram& other) const {
+	if (m_empty || other.m_empty) {
+		return 1.0;
+	}
+	double coefficient = dot(m_sqrt.data(), other.m_sqrt.data(), kBins);
+	return std::sqrt(std::max(1.0 - coefficient, 0.0));
+}
+
+Mat HsHistogram::toMat() const {
+	Mat hist;
+	toMat(hist);
+	return hist;
+}
+
+void HsHistogram::toMat(Mat& hist) const {
+	hist.create(kHueBins, kSatBins, CV_32F);
+	float* p = hist.ptr<float>();
+	for (int i = 0; i < kBins; i++) {
+		p[i] = m_sqrt[i] * m_sqrt[i];
+	}
+}
+
+int HistogramBank::add(const string& name, const Mat& image) {
+	HsHistogram hist;
+	if (!hist.compute(image)) {
+		return -1;
+	}
+	return add(name, hist);
+}
+
+int HistogramBank::add(const string& name, const HsHistogram& hist) {
+	m_entries.push_back({ name, hist });
+	return static_cast<int>(m_entries.size()) - 1;
+}
+
+HistogramMatch HistogramBank::best(const HsHistogram& query, double maxDistance) const {
+	SNOW_SCOPED_TIMER("HistogramBank.best");
+	HistogramMatch match;
+	if (query.empty()) {
+		return match;
+	}
+
+	// 距离 d = sqrt(1 - BC)，d <= maxDistance 等价于 BC >= 1 - maxDistance^2
+	double limit = std::min(maxDistance, 1.0);
+	float bestCoefficient = static_cast<float>(1.0 - limit * limit);
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		const HsHistogram& templ = m_entries[i].hist;
+		if (templ.empty()) {
+			continue;
+		}
+		float coefficient = 0;
+		bool pruned = false;
+		for (int k = 0; k < HsHistogram::kChunks; k++) {
+			int offset = k * HsHistogram::kChunkSize;
+			coefficient += dot(query.m_sqrt.data() + offset, templ.m_sqrt.data() + offset, HsHistogram::kChunkSize);
+			// 剩余分块的系数不超过 sqrt(剩余质量A * 剩余质量B)
+			float bound = coefficient + std::sqrt(query.m_suffixMass[k + 1] * templ.m_suffixMass[k + 1]);
+			if (bound < bestCoefficient) {
+				pruned = true;
+				break;
+			}
+		}
+		if (pruned) {
+			continue;
+		}
+		if (coefficient > bestCoefficient || (match.index < 0 && coefficient >= bestCoefficient)) {
+			bestCoefficient = coefficient;
+			match.index = static_cast<int>(i);
+			match.distance = std::sqrt(std::max(1.0 - coefficient, 0.0));
+		}
+	}
+	return match;
+}
+
+HistogramMatch HistogramBank::best(const Mat& crop, double maxDistance) const {
+	HsHistogram query;
+	if (!query.compute(crop)) {
+		return HistogramMatch();
+	}
+	return best(query, maxDistance);
+}
+
+void HistogramBank::compareAll(const HsHistogram& query, vector<double>& outDistances) const {
+	outDistances.resize(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++) {
+		outDistances[i] = query.bhattacharyya(m_entries[i].hist);
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * @brief HSV 色调-饱和度直方图（50x60 个分箱，L1 归一化）
+ *
+ * 直接在 BGR 像素上一次遍历完成 HSV 转换与分箱，不生成 HSV 中间图像；
+ * 转换使用与 cvtColor(COLOR_BGR2HSV) 相同的 8 位定点公式，分箱与 calcHist 一致，
+ * 因此结果与 cvtColor + calcHist + normalize 相同。
+ * 分箱以平方根形式保存在固定大小的数组中（约 12KB），Bhattacharyya 系数只需一次点积。
+ */
+class HsHistogram {
+public:
+	static constexpr int kHueBins = 50;
+	static constexpr int kSatBins = 60;
+	static constexpr int kBins = kHueBins * kSatBins;
+	static constexpr int kChunkSize = 250;
+	static constexpr int kChunks = kBins / kChunkSize;
+
+	HsHistogram();
+
+	/**
+	 * @brief 统计图像的 H-S 直方图
+	 * @param image BGR 或 BGRA 8 位图像
+	 * @return 是否成功
+	 */
+	bool compute(const cv::Mat& image);
+
+	/**
+	 * @brief 由已转换的 HSV 图像（cvtColor COLOR_BGR2HSV 的结果）统计，只做分箱
+	 * 帧的 HSV 平面已经缓存（FramePlanes）时使用，结果与 compute 相同
+	 */
+	bool computeHsv(const cv::Mat& hsv);
+
+	/**
+	 * @brief 从 50x60 的直方图 Mat（如 Image2Hist 的结果）构造，自动按 L1 归一化
+	 */
+	bool assign(const cv::Mat& hist);
+
+	// Bhattacharyya 距离，与 compareHist(HISTCMP_BHATTACHARYYA) 含义相同
+	double bhattacharyya(const HsHistogram& other) const;
+
+	// 转换为 50x60 CV_32F 的直方图 Mat，与 Image2Hist 格式一致
+	cv::Mat toMat() const;
+	// 写入已有的 Mat，尺寸类型一致时不重新分配
+	void toMat(cv::Mat& hist) const;
+
+	bool empty() const { return m_empty; }
+
+private:
+	friend class HistogramBank;
+
+	void finalize();
+
+	alignas(64) std::array<float, kBins> m_sqrt; // 归一化分箱的平方根
+	std::array<float, kChunks + 1> m_suffixMass;  // 从第 k 个分块到末尾的分箱总和，用于提前结束比较
+	bool m_empty = true;
+};
+
+// 直方图库中的最佳匹配
+struct HistogramMatch {
+	int index = -1;         // 模板索引，没有满足条件的模板时为 -1
+	double distance = 1.0;  // Bhattacharyya 距离，越小越相似
+};
+
+/**
+ * @brief 模板直方图库
+ * 一次调用将一个裁剪区域与库中全部模板直方图比较。
+ * 求最佳匹配时按分块累加 Bhattacharyya 系数，并用 Cauchy-Schwarz 不等式估计剩余分块的上界，
+ * 一旦某个模板不可能优于当前最佳结果（或 maxDistance）就提前放弃。
+ */
+class HistogramBank {
+public:
+	// 返回模板索引，失败返回 -1
+	int add(const std::string& name, const cv::Mat& image);
+	int add(const std::string& name, const HsHistogram& hist);
+
+	size_t size() const { return m_entries.size(); }
+	bool empty() const { return m_entries.empty(); }
+	const std::string& name(size_t index) const { return m_entries[index].name; }
+	const HsHistogram& histogram(size_t index) const { return m_entries[index].hist; }
+
+	// 距离最小的模板，距离超过 maxDistance 的模板提前放弃
+	HistogramMatch best(const HsHistogram& query, double maxDistance = 1.0) const;
+	HistogramMatch best(const cv::Mat& crop, double maxDistance = 1.0) const;
+
+	// 与全部模板的距离，顺序与添加顺序一致
+	void compareAll(const HsHistogram& query, std::vector<double>& outDistances) const;
+
+private:
+	struct Entry {
+		std::string name;
+		HsHistogram hist;
+	};
+
+	std::vector<Entry> m_entries;
+};
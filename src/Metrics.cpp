@@ -0,0 +1,152 @@
+#include "Metrics.h"
+#include <bit>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram(string name)
+	: m_name(std::move(name)) {
+	for (auto& bucket : m_buckets) {
+		bucket.store(0, memory_order_relaxed);
+	}
+}
+
+int LatencyHistogram::bucketOf(uint64_t nanos) {
+	if (nanos < kSubBuckets) {
+		return static_cast<int>(nanos);
+	}
+	int exponent = 63 - countl_zero(nanos);
+	int sub = static_cast<int>((nanos >> (exponent - kSubBits)) & (kSubBuckets - 1));
+	return kSubBuckets + (exponent - kSubBits) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketLower(int index) {
+	if (index < kSubBuckets) {
+		return static_cast<uint64_t>(index);
+	}
+	int exponent = (index - kSubBuckets) / kSubBuckets + kSubBits;
+	int sub = (index - kSubBuckets) % kSubBuckets;
+	return static_cast<uint64_t>(kSubBuckets + sub) << (exponent - kSubBits);
+}
+
+uint64_t LatencyHistogram::bucketUpper(int index) {
+	if (index < kSubBuckets) {
+		return static_cast<uint64_t>(index) + 1;
+	}
+	int exponent = (index - kSubBuckets) / kSubBuckets + kSubBits;
+	return bucketLower(index) + (1ULL << (exponent - kSubBits));
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+	m_buckets[bucketOf(nanos)].fetch_add(1, memory_order_relaxed);
+	m_count.fetch_add(1, memory_order_relaxed);
+	m_sum.fetch_add(nanos, memory_order_relaxed);
+	uint64_t prev = m_max.load(memory_order_relaxed);
+	while (nanos > prev && !m_max.compare_exchange_weak(prev, nanos, memory_order_relaxed)) {
+	}
+}
+
+double LatencyHistogram::percentile(double p) const {
+	uint64_t total = count();
+	if (total == 0) {
+		return 0.0;
+	}
+	uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total - 1)) + 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < kBuckets; i++) {
+		seen += m_buckets[i].load(memory_order_relaxed);
+		if (seen >= rank) {
+			double mid = (static_cast<double>(bucketLower(i)) + static_cast<double>(bucketUpper(i))) / 2.0;
+			return std::min(mid, static_cast<double>(maxNanos()));
+		}
+	}
+	return static_cast<double>(maxNanos());
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+	static MetricsRegistry registry;
+	return registry;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const string& name) {
+	lock_guard<mutex> lock(m_mutex);
+	for (auto& h : m_histograms) {
+		if (h->name() == name) {
+			return *h;
+		}
+	}
+	m_histograms.push_back(make_unique<LatencyHistogram>(name));
+	return *m_histograms.back();
+}
+
+void MetricsRegistry::writeJson(ostream& os) const {
+	lock_guard<mutex> lock(m_mutex);
+	os << "{\"stages\":[";
+	bool first = true;
+	for (const auto& h : m_histograms) {
+		uint64_t n = h->count();
+		os << (first ? "" : ",") << "{\"name\":\"" << h->name() << "\""
+			<< ",\"count\":" << n
+			<< ",\"mean_us\":" << (n ? h->totalNanos() / 1000.0 / n : 0.0)
+			<< ",\"p50_us\":" << h->percentile(50) / 1000.0
+			<< ",\"p95_us\":" << h->percentile(95) / 1000.0
+			<< ",\"p99_us\":" << h->percentile(99) / 1000.0
+			<< ",\"max_us\":" << h->maxNanos() / 1000.0 << "}";
+		first = false;
+	}
+	os << "]}" << endl;
+}
+
+void MetricsRegistry::writeCsv(ostream& os) const {
+	lock_guard<mutex> lock(m_mutex);
+	os << "stage,count,mean_us,p50_us,p95_us,p99_us,max_us" << endl;
+	for (const auto& h : m_histograms) {
+		uint64_t n = h->count();
+		os << h->name() << "," << n
+			<< "," << (n ? h->totalNanos() / 1000.0 / n : 0.0)
+			<< "," << h->percentile(50) / 1000.0
+			<< "," << h->percentile(95) / 1000.0
+			<< "," << h->percentile(99) / 1000.0
+			<< "," << h->maxNanos() / 1000.0 << endl;
+	}
+}
+
+bool MetricsRegistry::dump(const string& path) const {
+	// 命令行模式不会像调试图像那样预先创建 ./logs
+	filesystem::path parent = filesystem::path(path).parent_path();
+	if (!parent.empty()) {
+		error_code ec;
+		filesystem::create_directories(parent, ec);
+	}
+	ofstream file(path);
+	if (!file) {
+		cerr << "failed to open metrics file: " << path << endl;
+		return false;
+	}
+	bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	if (csv) {
+		writeCsv(file);
+	}
+	else {
+		writeJson(file);
+	}
+	return true;
+}
+
+void MetricsRegistry::dumpAtExit(const string& path) {
+	{
+		lock_guard<mutex> lock(m_mutex);
+		bool registered = !m_exitPath.empty();
+		m_exitPath = path;
+		if (registered) {
+			return;
+		}
+	}
+	atexit([]() {
+		MetricsRegistry& registry = instance();
+		registry.dump(registry.m_exitPath);
+	});
+}
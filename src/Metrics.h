@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief 延迟直方图
+ * 对数分桶（每个 2 倍区间 8 个子桶，相对误差约 6%），记录只需几次无锁原子加，
+ * 可在任意线程并发调用。
+ */
+class LatencyHistogram {
+public:
+	static constexpr int kSubBits = 3;
+	static constexpr int kSubBuckets = 1 << kSubBits;
+	static constexpr int kBuckets = kSubBuckets + (64 - kSubBits) * kSubBuckets;
+
+	explicit LatencyHistogram(std::string name);
+
+	void record(uint64_t nanos);
+
+	const std::string& name() const { return m_name; }
+	uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t totalNanos() const { return m_sum.load(std::memory_order_relaxed); }
+	uint64_t maxNanos() const { return m_max.load(std::memory_order_relaxed); }
+	// 百分位数（0~100），返回所在桶的中点，单位纳秒
+	double percentile(double p) const;
+
+private:
+	static int bucketOf(uint64_t nanos);
+	static uint64_t bucketLower(int index);
+	static uint64_t bucketUpper(int index);
+
+	std::string m_name;
+	std::atomic<uint64_t> m_buckets[kBuckets];
+	std::atomic<uint64_t> m_count{ 0 };
+	std::atomic<uint64_t> m_sum{ 0 };
+	std::atomic<uint64_t> m_max{ 0 };
+};
+
+/**
+ * @brief 全局指标注册表
+ * 每个计时点第一次执行时按名称取得直方图（加锁一次），之后只做原子计数。
+ */
+class MetricsRegistry {
+public:
+	static MetricsRegistry& instance();
+
+	LatencyHistogram& histogram(const std::string& name);
+
+	void writeJson(std::ostream& os) const;
+	void writeCsv(std::ostream& os) const;
+	// 按扩展名（.json / .csv）写入文件
+	bool dump(const std::string& path) const;
+	// 进程正常退出时写入文件
+	void dumpAtExit(const std::string& path);
+
+private:
+	MetricsRegistry() = default;
+
+	mutable std::mutex m_mutex;
+	std::deque<std::unique_ptr<LatencyHistogram>> m_histograms;
+	std::string m_exitPath;
+};
+
+// 作用域计时：析构时记录
+class ScopedTimer {
+public:
+	explicit ScopedTimer(LatencyHistogram& histogram)
+		: m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {
+	}
+	~ScopedTimer() {
+		m_histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count()));
+	}
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	LatencyHistogram& m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// 顺序阶段计时：进入下一阶段时结束上一阶段，适合函数内部连续的多个步骤
+class StageTimer {
+public:
+	StageTimer() = default;
+	~StageTimer() { end(); }
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+	void next(LatencyHistogram& histogram) {
+		auto now = std::chrono::steady_clock::now();
+		record(now);
+		m_current = &histogram;
+		m_start = now;
+	}
+	void end() {
+		record(std::chrono::steady_clock::now());
+		m_current = nullptr;
+	}
+
+private:
+	void record(std::chrono::steady_clock::time_point now) {
+		if (m_current) {
+			m_current->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count()));
+		}
+	}
+
+	LatencyHistogram* m_current = nullptr;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * 计时宏：只有定义 SNOW_ENABLE_METRICS 时才生效，否则展开为空，没有任何开销。
+ *   SNOW_SCOPED_TIMER("name");            // 计时到当前作用域结束
+ *   SNOW_STAGE_BEGIN(t, "a"); ...         // 顺序阶段计时
+ *   SNOW_STAGE_NEXT(t, "b"); ...
+ *   SNOW_STAGE_END(t);
+ */
+#ifdef SNOW_ENABLE_METRICS
+#define SNOW_METRICS_CONCAT_(a, b) a##b
+#define SNOW_METRICS_CONCAT(a, b) SNOW_METRICS_CONCAT_(a, b)
+#define SNOW_SCOPED_TIMER(name) \
+	static LatencyHistogram& SNOW_METRICS_CONCAT(snowHistogram_, __LINE__) = MetricsRegistry::instance().histogram(name); \
+	ScopedTimer SNOW_METRICS_CONCAT(snowTimer_, __LINE__)(SNOW_METRICS_CONCAT(snowHistogram_, __LINE__))
+#define SNOW_STAGE_BEGIN(timer, name) \
+	StageTimer timer; \
+	SNOW_STAGE_NEXT(timer, name)
+#define SNOW_STAGE_NEXT(timer, name) \
+	do { static LatencyHistogram& snowStage_ = MetricsRegistry::instance().histogram(name); timer.next(snowStage_); } while (0)
+#define SNOW_STAGE_END(timer) timer.end()
+#else
+#define SNOW_SCOPED_TIMER(name) ((void)0)
+#define SNOW_STAGE_BEGIN(timer, name) ((void)0)
+#define SNOW_STAGE_NEXT(timer, name) ((void)0)
+#define SNOW_STAGE_END(timer) ((void)0)
+#endif
@@ -0,0 +1,196 @@
+#include "Pipeline.h"
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+static uint64_t elapsedNanos(chrono::steady_clock::time_point start) {
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+// 队列为空时的等待：先让出时间片，持续为空再短暂休眠，避免空转占满核心
+static void idleWait(int& idleRounds) {
+	if (++idleRounds < 64) {
+		this_thread::yield();
+	}
+	else {
+		this_thread::sleep_for(chrono::microseconds(200));
+	}
+}
+
+Pipeline::Pipeline(CaptureFunc capture, ResultFunc onResult, const Config& config)
+	: m_capture(std::move(capture)),
+	m_onResult(std::move(onResult)),
+	m_config(config) {
+}
+
+Pipeline::Pipeline(CaptureFunc capture, ResultFunc onResult)
+	: Pipeline(std::move(capture), std::move(onResult), Config()) {
+}
+
+Pipeline::Pipeline(FrameSource& source, ResultFunc onResult, const Config& config)
+	: Pipeline(CaptureFunc(), std::move(onResult), config) {
+	m_source = &source;
+	if (source.sharesBuffer()) {
+		// 数据源的缓冲区会被下一帧覆盖，入队前拷贝
+		m_capture = [&source, view = Mat()](Mat& frame) mutable {
+			if (!source.read(view)) {
+				return false;
+			}
+			view.copyTo(frame);
+			return true;
+		};
+	}
+	else {
+		m_capture = [&source](Mat& frame) {
+			return source.read(frame);
+		};
+	}
+}
+
+Pipeline::~Pipeline() {
+	stop();
+}
+
+bool Pipeline::start() {
+	if (m_running.load()) {
+		return false;
+	}
+	if (!m_capture) {
+		cerr << "Pipeline has no capture function" << endl;
+		return false;
+	}
+
+	m_running.store(true);
+	m_captureFinished.store(false);
+	m_solveThread = thread(&Pipeline::solveLoop, this);
+	m_recognizeThread = thread(&Pipeline::recognizeLoop, this);
+	m_captureThread = thread(&Pipeline::captureLoop, this);
+	return true;
+}
+
+void Pipeline::stop() {
+	m_running.store(false);
+	for (thread* t : { &m_captureThread, &m_recognizeThread, &m_solveThread }) {
+		if (t->joinable()) {
+			t->join();
+		}
+	}
+}
+
+PipelineStats Pipeline::stats() const {
+	PipelineStats s;
+	s.captured = m_captured.load();
+	s.recognized = m_recognized.load();
+	s.solved = m_solved.load();
+	s.overwritten = m_overwritten.load();
+	s.lastLatencyMs = m_lastLatencyMs.load();
+	s.maxLatencyMs = m_maxLatencyMs.load();
+	return s;
+}
+
+void Pipeline::captureLoop() {
+	uint64_t frameIndex = 0;
+	while (m_running.load(memory_order_relaxed)) {
+		FramePacket packet;
+		if (!m_capture(packet.frame) || packet.frame.empty()) {
+			if (m_source && m_source->finished()) {
+				m_captureFinished.store(true);
+				return;
+			}
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+		packet.frameIndex = frameIndex++;
+		packet.captureTime = chrono::steady_clock::now();
+		m_captured.fetch_add(1, memory_order_relaxed);
+
+		// 识别阶段尚未取走的上一帧被这一帧替换
+		if (m_frameQueue.push(std::move(packet))) {
+			m_overwritten.fetch_add(1, memory_order_relaxed);
+		}
+	}
+}
+
+void Pipeline::recognizeLoop() {
+	GridAnalyzer analyzer;
+	FramePacket packet;
+	RecognitionContext context;
+	FramePlanes planes;
+	int idleRounds = 0;
+	while (m_running.load(memory_order_relaxed)) {
+		if (!m_frameQueue.popLatest(packet)) {
+			idleWait(idleRounds);
+			continue;
+		}
+		idleRounds = 0;
+
+		RecognitionResult result;
+		result.frameIndex = packet.frameIndex;
+		result.captureTime = packet.captureTime;
+		auto start = chrono::steady_clock::now();
+		result.timings.push_back({ "queue", static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(start - packet.captureTime).count()) });
+		// 本帧的灰度图、边缘图等由网格分析共享，结果放入队列前释放对帧的引用
+		planes.reset(packet.frame);
+		result.gridFound = m_config.incremental ? analyzer.analyze(planes, result.cells) : analyzeGrid(planes, result.cells, GridLayout(), context);
+		planes.clear();
+		result.timings.push_back({ "analyze", elapsedNanos(start) });
+		if (m_config.templates && !m_config.templates->empty()) {
+			// 模板库自带的派生数据（彩色积分图、浮点通道）不与网格分析重叠，不经过 planes
+			start = chrono::steady_clock::now();
+			m_config.templates->matchAll(packet.frame, result.matches);
+			result.timings.push_back({ "match", elapsedNanos(start) });
+		}
+		result.frame = std::move(packet.frame);
+		m_recognized.fetch_add(1, memory_order_relaxed);
+
+		if (m_resultQueue.push(std::move(result))) {
+			m_overwritten.fetch_add(1, memory_order_relaxed);
+		}
+	}
+}
+
+void Pipeline::solveLoop() {
+	RecognitionResult result;
+	PuzzleSolution solution;
+	AnytimeSolution anytime;
+	int idleRounds = 0;
+	while (m_running.load(memory_order_relaxed)) {
+		if (!m_resultQueue.popLatest(result)) {
+			idleWait(idleRounds);
+			continue;
+		}
+		idleRounds = 0;
+
+		const PuzzleSolution* solved = nullptr;
+		auto start = chrono::steady_clock::now();
+		if (result.gridFound && m_config.solverService && m_config.solveBudgetMs > 0) {
+			// 识别与求解合计不超过预算：超时返回部分放置（solution.complete 为 false），后台继续搜索
+			auto deadline = result.captureTime + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(m_config.solveBudgetMs));
+			if (m_config.solverService->solveAnytime(result.cells, deadline, anytime)) {
+				solved = &anytime.solution;
+			}
+		}
+		else if (result.gridFound) {
+			bool found = m_config.solverService ? m_config.solverService->solve(result.cells, solution)
+				: m_config.solver && m_config.solver->solve(result.cells, solution);
+			if (found) {
+				solved = &solution;
+			}
+		}
+		if (m_config.trace) {
+			result.timings.push_back({ "solve", elapsedNanos(start) });
+			m_config.trace->append(result.frameIndex, result.captureTime, result.frame, result.gridFound, result.cells, result.timings);
+		}
+		if (m_onResult) {
+			m_onResult(result, solved);
+		}
+		m_solved.fetch_add(1, memory_order_relaxed);
+
+		double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - result.captureTime).count();
+		m_lastLatencyMs.store(latency, memory_order_relaxed);
+		if (latency > m_maxLatencyMs.load(memory_order_relaxed)) {
+			m_maxLatencyMs.store(latency, memory_order_relaxed);
+		}
+	}
+}
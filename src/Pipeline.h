@@ -0,0 +1,114 @@
+#pragma once
+
+#include "recognition.h"
+#include "TemplateBank.h"
+#include "PuzzleSolver.h"
+#include "SolverService.h"
+#include "SpscQueue.h"
+#include "TraceLog.h"
+#include "FrameSource.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 流水线中一帧的识别结果
+ */
+struct RecognitionResult {
+	uint64_t frameIndex = 0;
+	std::chrono::steady_clock::time_point captureTime;
+	cv::Mat frame;
+	bool gridFound = false;
+	std::vector<CellInfo> cells;
+	std::vector<TemplateMatchResult> matches;
+	std::vector<StageTiming> timings;  // 本帧各阶段耗时，随追踪日志一起记录
+};
+
+/**
+ * @brief 流水线运行统计
+ */
+struct PipelineStats {
+	uint64_t captured = 0;       // 捕获成功的帧数
+	uint64_t recognized = 0;     // 完成识别的帧数
+	uint64_t solved = 0;         // 完成求解阶段的帧数
+	uint64_t overwritten = 0;    // 下游取走之前就被更新的帧覆盖而丢弃的帧数
+	double lastLatencyMs = 0;    // 最近一帧从捕获到求解完成的延迟
+	double maxLatencyMs = 0;
+};
+
+/**
+ * @brief 捕获 -> 识别 -> 求解 流水线
+ *
+ * 三个阶段各自运行在独立线程上，阶段之间用容量为 1 的 SPSC 无锁队列连接。
+ * 下游还没取走上一项时，上游的新项直接覆盖它，下游每次取到的都是最新的一帧，
+ * 因此吞吐量只受最慢阶段限制，端到端延迟不会因积压而增长。
+ */
+class Pipeline {
+public:
+	// 捕获一帧；输出的 Mat 不能与之后会被覆盖的缓冲区共享数据（CaptureSession 的视图需先拷贝）
+	typedef std::function<bool(cv::Mat&)> CaptureFunc;
+	// 求解阶段完成后的回调，solution 在未配置求解器或无解时为空；anytime 模式超时时为部分放置（complete 为 false）
+	typedef std::function<void(const RecognitionResult&, const PuzzleSolution*)> ResultFunc;
+
+	struct Config {
+		bool incremental = true;               // 识别阶段使用 GridAnalyzer 增量分析
+		const TemplateBank* templates = nullptr; // 非空时识别阶段对每帧批量模板匹配
+		PuzzleSolver* solver = nullptr;          // 非空时求解阶段对识别出的棋盘求解
+		SolverService* solverService = nullptr;  // 非空时代替 solver，跨帧复用置换表
+		double solveBudgetMs = 0;                // > 0 时 solverService 以 anytime 模式求解，截止时间为捕获时刻 + 预算
+		TraceWriter* trace = nullptr;            // 非空时求解阶段把每帧画面与结果追加到追踪日志
+	};
+
+	Pipeline(CaptureFunc capture, ResultFunc onResult, const Config& config);
+	Pipeline(CaptureFunc capture, ResultFunc onResult);
+	// 从数据源捕获；离线数据源读完后捕获线程结束，captureFinished() 变为 true。source 的生命周期须长于 Pipeline
+	Pipeline(FrameSource& source, ResultFunc onResult, const Config& config);
+	~Pipeline();
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	bool start();
+	// 通知所有阶段退出并等待线程结束
+	void stop();
+	bool running() const { return m_running.load(); }
+	bool captureFinished() const { return m_captureFinished.load(); }
+
+	PipelineStats stats() const;
+
+private:
+	struct FramePacket {
+		uint64_t frameIndex = 0;
+		std::chrono::steady_clock::time_point captureTime;
+		cv::Mat frame;
+	};
+
+	void captureLoop();
+	void recognizeLoop();
+	void solveLoop();
+
+	CaptureFunc m_capture;
+	FrameSource* m_source = nullptr;
+	ResultFunc m_onResult;
+	Config m_config;
+
+	SpscQueue<FramePacket> m_frameQueue;
+	SpscQueue<RecognitionResult> m_resultQueue;
+
+	std::atomic<bool> m_running{ false };
+	std::atomic<bool> m_captureFinished{ false };
+	std::thread m_captureThread;
+	std::thread m_recognizeThread;
+	std::thread m_solveThread;
+
+	std::atomic<uint64_t> m_captured{ 0 };
+	std::atomic<uint64_t> m_recognized{ 0 };
+	std::atomic<uint64_t> m_solved{ 0 };
+	std::atomic<uint64_t> m_overwritten{ 0 };
+	std::atomic<double> m_lastLatencyMs{ 0 };
+	std::atomic<double> m_maxLatencyMs{ 0 };
+};
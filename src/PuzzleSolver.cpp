@@ -0,0 +1,644 @@
+#include "PuzzleSolver.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <iostream>
+#include <mutex>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+using namespace std;
+
+typedef vector<pair<int, int>> CellList;
+
+// 平移到 (0, 0) 并排序，得到可比较的形状表示
+static CellList normalizeCells(CellList cells) {
+	int minRow = cells.front().first;
+	int minCol = cells.front().second;
+	for (const auto& c : cells) {
+		minRow = std::min(minRow, c.first);
+		minCol = std::min(minCol, c.second);
+	}
+	for (auto& c : cells) {
+		c.first -= minRow;
+		c.second -= minCol;
+	}
+	sort(cells.begin(), cells.end());
+	cells.erase(unique(cells.begin(), cells.end()), cells.end());
+	return cells;
+}
+
+// 所有不重复的旋转（及可选的翻转）
+static vector<CellList> orientations(const CellList& cells, bool allowReflection) {
+	vector<CellList> result;
+	CellList current = cells;
+	for (int flip = 0; flip < (allowReflection ? 2 : 1); flip++) {
+		for (int rot = 0; rot < 4; rot++) {
+			CellList normalized = normalizeCells(current);
+			if (find(result.begin(), result.end(), normalized) == result.end()) {
+				result.push_back(normalized);
+			}
+			for (auto& c : current) {
+				c = { c.second, -c.first };
+			}
+		}
+		for (auto& c : current) {
+			c.second = -c.second;
+		}
+	}
+	return result;
+}
+
+// SplitMix64，生成固定的 Zobrist 键，同一组拼图块每次运行得到相同的哈希
+static uint64_t splitMix64(uint64_t& state) {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+int PuzzleSolution::pieceAt(int row, int col) const {
+	uint64_t bit = 1ULL << (row * cols + col);
+	for (const auto& p : placements) {
+		if (p.mask & bit) {
+			return p.piece;
+		}
+	}
+	return -1;
+}
+
+PuzzleSolver::PuzzleSolver(const vector<PuzzlePiece>& pieces, bool allowReflection)
+	: m_pieces(pieces), m_allowReflection(allowReflection) {
+	// 形状相同（旋转/翻转意义下）的拼图块归为一类
+	vector<CellList> canonical;
+	m_pieceShape.assign(m_pieces.size(), -1);
+	for (size_t i = 0; i < m_pieces.size(); i++) {
+		if (m_pieces[i].cells.empty()) {
+			cerr << "Empty puzzle piece: " << m_pieces[i].name << endl;
+			continue;
+		}
+		vector<CellList> all = orientations(m_pieces[i].cells, m_allowReflection);
+		CellList key = *min_element(all.begin(), all.end());
+
+		auto it = find(canonical.begin(), canonical.end(), key);
+		if (it == canonical.end()) {
+			canonical.push_back(key);
+			m_shapes.push_back(normalizeCells(m_pieces[i].cells));
+			m_shapePieces.push_back({ static_cast<int>(i) });
+			m_pieceShape[i] = static_cast<int>(m_shapes.size()) - 1;
+		}
+		else {
+			m_shapePieces[it - canonical.begin()].push_back(static_cast<int>(i));
+			m_pieceShape[i] = static_cast<int>(it - canonical.begin());
+		}
+	}
+
+	m_minShapeSize = INT_MAX;
+	for (const auto& shape : m_shapes) {
+		m_minShapeSize = std::min(m_minShapeSize, static_cast<int>(shape.size()));
+	}
+	if (m_minShapeSize == INT_MAX) {
+		m_minShapeSize = 1;
+	}
+
+	uint64_t seed = 0x536E6F77ULL;
+	for (uint64_t& key : m_cellKeys) {
+		key = splitMix64(seed);
+	}
+	m_countKeys.resize(m_shapes.size());
+	for (size_t s = 0; s < m_shapes.size(); s++) {
+		m_countKeys[s].resize(m_shapePieces[s].size() + 1);
+		for (uint64_t& key : m_countKeys[s]) {
+			key = splitMix64(seed);
+		}
+	}
+}
+
+bool PuzzleSolver::boardFromCells(const vector<CellInfo>& cells, Bitboard& board) {
+	board = Bitboard();
+	for (const auto& cell : cells) {
+		board.rows = std::max(board.rows, cell.row);
+		board.cols = std::max(board.cols, cell.col);
+	}
+	if (board.rows <= 0 || board.cols <= 0 || board.rows * board.cols > 64) {
+		cerr << "Unsupported board size: " << board.rows << "x" << board.cols << endl;
+		return false;
+	}
+
+	for (const auto& cell : cells) {
+		uint64_t bit = 1ULL << board.bit(cell.row - 1, cell.col - 1);
+		if (cell.status == CellInfo::Status::AVAILABLE) {
+			board.target |= bit;
+		}
+		else {
+			board.blocked |= bit;
+		}
+	}
+	return true;
+}
+
+bool PuzzleSolver::prepare(int rows, int cols) {
+	if (rows == m_rows && cols == m_cols && !m_moveOffsets.empty()) {
+		return true;
+	}
+	if (rows <= 0 || cols <= 0 || rows * cols > 64) {
+		cerr << "Unsupported board size: " << rows << "x" << cols << endl;
+		return false;
+	}
+
+	m_rows = rows;
+	m_cols = cols;
+	uint64_t seed = 0x536E6F77ULL ^ (static_cast<uint64_t>(rows) << 40) ^ (static_cast<uint64_t>(cols) << 48);
+	m_sizeKey = splitMix64(seed);
+	int cells = rows * cols;
+	m_full = cells == 64 ? ~0ULL : (1ULL << cells) - 1;
+	m_firstCol = m_lastCol = 0;
+	for (int r = 0; r < rows; r++) {
+		m_firstCol |= 1ULL << (r * cols);
+		m_lastCol |= 1ULL << (r * cols + cols - 1);
+	}
+	vector<vector<Move>> movesByCell(cells);
+	vector<vector<CellList>> shapeOrientations(m_shapes.size());
+	for (size_t s = 0; s < m_shapes.size(); s++) {
+		shapeOrientations[s] = orientations(m_shapes[s], m_allowReflection);
+		for (const auto& o : shapeOrientations[s]) {
+			int height = 0, width = 0;
+			for (const auto& c : o) {
+				height = std::max(height, c.first + 1);
+				width = std::max(width, c.second + 1);
+			}
+			for (int r0 = 0; r0 + height <= rows; r0++) {
+				for (int c0 = 0; c0 + width <= cols; c0++) {
+					uint64_t mask = 0;
+					for (const auto& c : o) {
+						mask |= 1ULL << ((r0 + c.first) * cols + c0 + c.second);
+					}
+					movesByCell[countr_zero(mask)].push_back({ static_cast<int>(s), mask });
+				}
+			}
+		}
+	}
+	// 按最低位格子连续存放，区间由 m_moveOffsets 给出
+	m_moves.clear();
+	m_moveOffsets.assign(cells + 1, 0);
+	for (int cell = 0; cell < cells; cell++) {
+		m_moves.insert(m_moves.end(), movesByCell[cell].begin(), movesByCell[cell].end());
+		m_moveOffsets[cell + 1] = static_cast<uint32_t>(m_moves.size());
+	}
+
+	m_fixed = makeBoardSearch(rows, cols);
+	if (m_fixed) {
+		m_fixed->build(shapeOrientations);
+	}
+	return true;
+}
+
+PuzzleSolver::SearchState PuzzleSolver::initialState(const vector<vector<int>>& shapePieces, int& pieceCells) const {
+	SearchState state;
+	pieceCells = 0;
+	state.shapeCount.assign(m_shapes.size(), 0);
+	for (size_t s = 0; s < m_shapes.size(); s++) {
+		state.shapeCount[s] = static_cast<int>(shapePieces[s].size());
+		pieceCells += state.shapeCount[s] * static_cast<int>(m_shapes[s].size());
+	}
+	return state;
+}
+
+void PuzzleSolver::reportProgress(uint64_t remaining, SearchState& state) const {
+	int covered = state.targetCells - popcount(remaining);
+	if (covered > state.bestCovered) {
+		state.bestCovered = covered;
+		(*state.onProgress)(state.path, covered);
+	}
+}
+
+bool PuzzleSolver::checkpoint(const SearchState& state) {
+	if (state.liveNodes) {
+		state.liveNodes->store(state.nodes, memory_order_relaxed);
+	}
+	return state.cancel && state.cancel->load(memory_order_relaxed);
+}
+
+span<const PuzzleSolver::Move> PuzzleSolver::movesAt(int cell) const {
+	return span<const Move>(m_moves.data() + m_moveOffsets[cell], m_moveOffsets[cell + 1] - m_moveOffsets[cell]);
+}
+
+uint64_t PuzzleSolver::neighbors(uint64_t mask) const {
+	uint64_t east = (mask & ~m_lastCol) << 1;
+	uint64_t west = (mask & ~m_firstCol) >> 1;
+	return (east | west | (mask << m_cols) | (mask >> m_cols)) & m_full;
+}
+
+bool PuzzleSolver::isolates(uint64_t remaining, uint64_t placed) const {
+	// 从放置周围的每个未覆盖格向外扩张，达到最小拼图块大小即可停止
+	uint64_t frontier = neighbors(placed) & remaining;
+	while (frontier) {
+		uint64_t region = frontier & (~frontier + 1);
+		while (popcount(region) < m_minShapeSize) {
+			uint64_t grown = (region | neighbors(region)) & remaining;
+			if (grown == region) {
+				return true;
+			}
+			region = grown;
+		}
+		frontier &= ~region;
+	}
+	return false;
+}
+
+bool PuzzleSolver::search(uint64_t remaining, int pieceCells, SearchState& state, const SolutionVisitor& onSolution) const {
+	state.nodes++;
+	if ((state.nodes & 1023) == 0 && checkpoint(state)) {
+		return true;
+	}
+	if (state.onProgress) {
+		reportProgress(remaining, state);
+	}
+	if (remaining == 0) {
+		return onSolution(state.path);
+	}
+	// 剩余拼图块的总格数不足以覆盖剩余目标；随时求解时这样的分支仍可能覆盖更多格子，不剪枝
+	if (popcount(remaining) > pieceCells && !state.onProgress) {
+		return false;
+	}
+
+	// 编号最小的未覆盖格必须由以它为最低位的放置覆盖；留下孤立小区域的放置没有完整解
+	int cell = countr_zero(remaining);
+	for (const Move& move : movesAt(cell)) {
+		if ((move.mask & remaining) != move.mask || state.shapeCount[move.shape] == 0
+			|| (!state.onProgress && isolates(remaining & ~move.mask, move.mask))) {
+			continue;
+		}
+		state.shapeCount[move.shape]--;
+		state.path.push_back(move);
+		bool stop = search(remaining & ~move.mask, pieceCells - static_cast<int>(m_shapes[move.shape].size()), state, onSolution);
+		state.path.pop_back();
+		state.shapeCount[move.shape]++;
+		if (stop) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t PuzzleSolver::cellsKey(uint64_t mask) const {
+	uint64_t key = 0;
+	for (; mask; mask &= mask - 1) {
+		key ^= m_cellKeys[countr_zero(mask)];
+	}
+	return key;
+}
+
+uint64_t PuzzleSolver::stateHash(uint64_t remaining, const vector<int>& shapeCount) const {
+	uint64_t hash = m_sizeKey ^ cellsKey(remaining);
+	for (size_t s = 0; s < shapeCount.size(); s++) {
+		hash ^= m_countKeys[s][shapeCount[s]];
+	}
+	return hash;
+}
+
+PuzzleSolver::SearchResult PuzzleSolver::searchCached(uint64_t remaining, uint64_t hash, int pieceCells, SearchState& state) const {
+	state.nodes++;
+	if ((state.nodes & 1023) == 0 && checkpoint(state)) {
+		return SearchResult::CANCELLED;
+	}
+	if (state.onProgress) {
+		reportProgress(remaining, state);
+	}
+	if (remaining == 0) {
+		return SearchResult::FOUND;
+	}
+	int depth = popcount(remaining);
+	if (depth > pieceCells && !state.onProgress) {
+		return SearchResult::NONE;
+	}
+
+	int cell = countr_zero(remaining);
+	span<const Move> moves = movesAt(cell);
+	// 放置 moves[i] 后的子状态：增量更新哈希，找到解时保留路径
+	auto tryMove = [&](size_t i) {
+		const Move& move = moves[i];
+		if ((move.mask & remaining) != move.mask || state.shapeCount[move.shape] == 0
+			|| (!state.onProgress && isolates(remaining & ~move.mask, move.mask))) {
+			return SearchResult::NONE;
+		}
+		int& count = state.shapeCount[move.shape];
+		uint64_t childHash = hash ^ cellsKey(move.mask) ^ m_countKeys[move.shape][count] ^ m_countKeys[move.shape][count - 1];
+		count--;
+		state.path.push_back(move);
+		SearchResult result = searchCached(remaining & ~move.mask, childHash, pieceCells - static_cast<int>(m_shapes[move.shape].size()), state);
+		if (result != SearchResult::FOUND) {
+			state.path.pop_back();
+			count++;
+		}
+		return result;
+	};
+
+	TranspositionTable::Entry entry;
+	state.probes++;
+	if (m_table->probe(hash, entry)) {
+		state.hits++;
+		if (entry.result == TranspositionTable::UNSOLVABLE) {
+			// 无解只说明不能完整覆盖，随时求解仍要在其中寻找覆盖更多格子的部分放置
+			if (!state.onProgress) {
+				return SearchResult::NONE;
+			}
+		}
+		// 已知有解：沿记录的第一步前进；记录与当前状态不符（哈希冲突）时按未命中继续搜索
+		else if (static_cast<size_t>(entry.move) < moves.size()) {
+			SearchResult result = tryMove(entry.move);
+			if (result != SearchResult::NONE) {
+				return result;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < moves.size(); i++) {
+		SearchResult result = tryMove(i);
+		if (result == SearchResult::FOUND) {
+			m_table->store(hash, TranspositionTable::SOLVED, static_cast<int>(i), depth);
+		}
+		if (result != SearchResult::NONE) {
+			return result;
+		}
+	}
+	m_table->store(hash, TranspositionTable::UNSOLVABLE, 0, depth);
+	return SearchResult::NONE;
+}
+
+bool PuzzleSolver::searchAll(uint64_t remaining, uint64_t hash, int pieceCells, SearchState& state, const SolutionVisitor& onSolution, bool& found) const {
+	state.nodes++;
+	if ((state.nodes & 1023) == 0 && checkpoint(state)) {
+		return true;
+	}
+	if (remaining == 0) {
+		found = true;
+		return onSolution(state.path);
+	}
+	int depth = popcount(remaining);
+	if (depth > pieceCells) {
+		return false;
+	}
+
+	// 有解记录只给出一个解，枚举时不能据此跳过，只使用无解记录
+	TranspositionTable::Entry entry;
+	state.probes++;
+	if (m_table->probe(hash, entry) && entry.result == TranspositionTable::UNSOLVABLE) {
+		state.hits++;
+		return false;
+	}
+
+	bool any = false;
+	int cell = countr_zero(remaining);
+	for (const Move& move : movesAt(cell)) {
+		if ((move.mask & remaining) != move.mask || state.shapeCount[move.shape] == 0 || isolates(remaining & ~move.mask, move.mask)) {
+			continue;
+		}
+		int& count = state.shapeCount[move.shape];
+		uint64_t childHash = hash ^ cellsKey(move.mask) ^ m_countKeys[move.shape][count] ^ m_countKeys[move.shape][count - 1];
+		count--;
+		state.path.push_back(move);
+		bool stop = searchAll(remaining & ~move.mask, childHash, pieceCells - static_cast<int>(m_shapes[move.shape].size()), state, onSolution, any);
+		state.path.pop_back();
+		count++;
+		if (stop) {
+			found |= any;
+			return true;
+		}
+	}
+	// 子树完整搜索过才能记录；中途停止时已经返回
+	if (!any) {
+		m_table->store(hash, TranspositionTable::UNSOLVABLE, 0, depth);
+	}
+	found |= any;
+	return false;
+}
+
+void PuzzleSolver::toSolution(const Bitboard& board, const vector<Move>& path, const vector<vector<int>>& shapePieces, PuzzleSolution& outSolution) const {
+	outSolution.rows = board.rows;
+	outSolution.cols = board.cols;
+	outSolution.placements.clear();
+	outSolution.complete = true;
+
+	// 同一形状的多个拼图块按顺序分配
+	vector<size_t> used(m_shapes.size(), 0);
+	for (const Move& move : path) {
+		int piece = shapePieces[move.shape][used[move.shape]++];
+		outSolution.placements.push_back({ piece, move.mask });
+	}
+}
+
+bool PuzzleSolver::solve(const vector<CellInfo>& cells, PuzzleSolution& outSolution) {
+	Bitboard board;
+	if (!boardFromCells(cells, board)) {
+		return false;
+	}
+	return solve(board, outSolution);
+}
+
+bool PuzzleSolver::solve(const Bitboard& board, PuzzleSolution& outSolution) {
+	return solveShapes(board, m_shapePieces, outSolution);
+}
+
+bool PuzzleSolver::solve(const Bitboard& board, const vector<int>& available, PuzzleSolution& outSolution) {
+	vector<vector<int>> shapePieces;
+	return availableShapes(available, shapePieces) && solveShapes(board, shapePieces, outSolution);
+}
+
+bool PuzzleSolver::solveAnytime(const Bitboard& board, const vector<int>* available, const atomic<bool>& cancel, const ProgressFunc& onProgress, PuzzleSolution& outSolution,
+	atomic<uint64_t>* liveNodes) {
+	vector<vector<int>> shapePieces;
+	if (available && !availableShapes(*available, shapePieces)) {
+		return false;
+	}
+	return solveShapes(board, available ? shapePieces : m_shapePieces, outSolution, &cancel, &onProgress, liveNodes);
+}
+
+// 只保留可用的拼图块，形状编号不变，因此哈希与完整拼图块集合的求解共用同一张表
+bool PuzzleSolver::availableShapes(const vector<int>& available, vector<vector<int>>& shapePieces) const {
+	shapePieces.assign(m_shapes.size(), vector<int>());
+	for (int piece : available) {
+		if (piece < 0 || piece >= static_cast<int>(m_pieces.size()) || m_pieceShape[piece] < 0) {
+			cerr << "Invalid puzzle piece index: " << piece << endl;
+			return false;
+		}
+		shapePieces[m_pieceShape[piece]].push_back(piece);
+	}
+	for (auto& pieces : shapePieces) {
+		sort(pieces.begin(), pieces.end());
+		pieces.erase(unique(pieces.begin(), pieces.end()), pieces.end());
+	}
+	return true;
+}
+
+bool PuzzleSolver::solveShapes(const Bitboard& board, const vector<vector<int>>& shapePieces, PuzzleSolution& outSolution,
+	const atomic<bool>* cancel, const ProgressFunc* onProgress, atomic<uint64_t>* liveNodes) {
+	SNOW_SCOPED_TIMER("PuzzleSolver.solve");
+	m_nodes = m_tableProbes = m_tableHits = 0;
+	if (!prepare(board.rows, board.cols)) {
+		return false;
+	}
+
+	int pieceCells = 0;
+	SearchState state = initialState(shapePieces, pieceCells);
+	uint64_t target = board.target & ~board.blocked;
+	state.cancel = cancel;
+	state.liveNodes = liveNodes;
+
+	// 部分放置转换为 PuzzleSolution 后交给调用方
+	PuzzleSolution partial;
+	function<void(const vector<Move>&, int)> progress = [&](const vector<Move>& path, int covered) {
+		toSolution(board, path, shapePieces, partial);
+		partial.complete = false;
+		(*onProgress)(partial, covered);
+	};
+	if (onProgress) {
+		state.targetCells = popcount(target);
+		state.onProgress = &progress;
+	}
+
+	bool found = false;
+	if (m_table) {
+		m_table->newGeneration();
+		found = searchCached(target, stateHash(target, state.shapeCount), pieceCells, state) == SearchResult::FOUND;
+		if (found) {
+			toSolution(board, state.path, shapePieces, outSolution);
+		}
+	}
+	else if (m_fixed && m_useFixed && !cancel && !onProgress) {
+		vector<BoardMove> path;
+		found = m_fixed->solve(target, state.shapeCount, pieceCells, path, state.nodes);
+		if (found) {
+			state.path.clear();
+			for (const BoardMove& move : path) {
+				state.path.push_back({ move.shape, move.mask });
+			}
+			toSolution(board, state.path, shapePieces, outSolution);
+		}
+	}
+	else {
+		search(target, pieceCells, state, [&](const vector<Move>& path) {
+			toSolution(board, path, shapePieces, outSolution);
+			found = true;
+			return true;
+		});
+	}
+	m_nodes = state.nodes;
+	m_tableProbes = state.probes;
+	m_tableHits = state.hits;
+	return found;
+}
+
+bool PuzzleSolver::solveParallel(const vector<CellInfo>& cells, vector<PuzzleSolution>& outSolutions, const ParallelSolveOptions& options) {
+	Bitboard board;
+	if (!boardFromCells(cells, board)) {
+		return false;
+	}
+	return solveParallel(board, outSolutions, options);
+}
+
+bool PuzzleSolver::solveParallel(const Bitboard& board, vector<PuzzleSolution>& outSolutions, const ParallelSolveOptions& options) {
+	SNOW_SCOPED_TIMER("PuzzleSolver.solveParallel");
+	outSolutions.clear();
+	m_nodes = m_tableProbes = m_tableHits = 0;
+	if (!prepare(board.rows, board.cols)) {
+		return false;
+	}
+
+	atomic<bool> stop{ false };
+	atomic<uint64_t> nodes{ 0 };
+	atomic<uint64_t> probes{ 0 };
+	atomic<uint64_t> hits{ 0 };
+	// 叶任务使用置换表：只找一个解时沿有解记录前进；枚举所有解时只用无解记录剪枝
+	bool cached = m_table != nullptr;
+	if (cached) {
+		m_table->newGeneration();
+	}
+	mutex solutionMutex;
+	tbb::task_group group;
+
+	// 收到解后决定是否取消其余任务
+	SolutionVisitor onSolution = [&](const vector<Move>& path) {
+		lock_guard<mutex> lock(solutionMutex);
+		if (stop.load(memory_order_relaxed)) {
+			return true;
+		}
+		outSolutions.emplace_back();
+		toSolution(board, path, m_shapePieces, outSolutions.back());
+		bool limitReached = !options.findAll || (options.maxSolutions > 0 && outSolutions.size() >= options.maxSolutions);
+		if (limitReached) {
+			stop.store(true, memory_order_relaxed);
+			group.cancel();
+		}
+		return limitReached;
+	};
+
+	// 前 splitDepth 层每个分支派生一个任务，其余层在任务内串行搜索
+	function<void(uint64_t, int, SearchState, int)> expand = [&](uint64_t remaining, int pieceCells, SearchState state, int depth) {
+		if (stop.load(memory_order_relaxed)) {
+			return;
+		}
+		state.cancel = &stop;
+		if (depth >= options.splitDepth || remaining == 0) {
+			if (cached && options.findAll) {
+				bool found = false;
+				searchAll(remaining, stateHash(remaining, state.shapeCount), pieceCells, state, onSolution, found);
+				probes.fetch_add(state.probes, memory_order_relaxed);
+				hits.fetch_add(state.hits, memory_order_relaxed);
+			}
+			else if (cached) {
+				if (searchCached(remaining, stateHash(remaining, state.shapeCount), pieceCells, state) == SearchResult::FOUND) {
+					onSolution(state.path);
+				}
+				probes.fetch_add(state.probes, memory_order_relaxed);
+				hits.fetch_add(state.hits, memory_order_relaxed);
+			}
+			else {
+				search(remaining, pieceCells, state, onSolution);
+			}
+			nodes.fetch_add(state.nodes, memory_order_relaxed);
+			return;
+		}
+
+		nodes.fetch_add(1, memory_order_relaxed);
+		if (popcount(remaining) > pieceCells) {
+			return;
+		}
+		int cell = countr_zero(remaining);
+		for (const Move& move : movesAt(cell)) {
+			if ((move.mask & remaining) != move.mask || state.shapeCount[move.shape] == 0 || isolates(remaining & ~move.mask, move.mask)) {
+				continue;
+			}
+			SearchState child = state;
+			child.nodes = 0;
+			child.shapeCount[move.shape]--;
+			child.path.push_back(move);
+			int childCells = pieceCells - static_cast<int>(m_shapes[move.shape].size());
+			uint64_t childRemaining = remaining & ~move.mask;
+			group.run([&expand, childRemaining, childCells, child = std::move(child), depth]() {
+				expand(childRemaining, childCells, child, depth + 1);
+			});
+		}
+	};
+
+	int pieceCells = 0;
+	SearchState root = initialState(m_shapePieces, pieceCells);
+	uint64_t target = board.target & ~board.blocked;
+	auto run = [&]() {
+		group.run([&]() { expand(target, pieceCells, root, 0); });
+		group.wait();
+	};
+	if (options.threads > 0) {
+		tbb::task_arena arena(options.threads);
+		arena.execute(run);
+	}
+	else {
+		run();
+	}
+
+	m_nodes = nodes.load();
+	m_tableProbes = probes.load();
+	m_tableHits = hits.load();
+	return !outSolutions.empty();
+}
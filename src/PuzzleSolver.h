@@ -0,0 +1,210 @@
+#pragma once
+
+#include "recognition.h"
+#include "TranspositionTable.h"
+#include "Board.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 拼图块
+ * 以 (行, 列) 偏移描述占据的格子，偏移可以任意平移，内部会规范化
+ */
+struct PuzzlePiece {
+	std::string name;
+	std::vector<std::pair<int, int>> cells;
+};
+
+/**
+ * @brief 位棋盘
+ * 格子 (row, col)（从 0 开始）对应第 row * cols + col 位，最多 64 格
+ */
+struct Bitboard {
+	int rows = 0;
+	int cols = 0;
+	uint64_t target = 0;  // 需要被覆盖的格子（AVAILABLE）
+	uint64_t blocked = 0; // 不可放置的格子（BLOCKED / FILLED）
+
+	int bit(int row, int col) const { return row * cols + col; }
+};
+
+// 一次放置：拼图块索引与其在棋盘上占据的格子掩码
+struct Placement {
+	int piece;
+	uint64_t mask;
+};
+
+struct PuzzleSolution {
+	int rows = 0;
+	int cols = 0;
+	std::vector<Placement> placements;
+	bool complete = true; // false 表示随时求解（anytime）在截止时间返回的部分放置，未覆盖全部目标格
+
+	// 返回覆盖 (row, col) 的拼图块索引，未覆盖返回 -1
+	int pieceAt(int row, int col) const;
+};
+
+// 并行求解选项
+struct ParallelSolveOptions {
+	int splitDepth = 3;       // 搜索树前几层展开为独立任务
+	bool findAll = false;     // 枚举所有解；否则找到第一个解后立即取消其余任务
+	size_t maxSolutions = 0;  // 枚举时的解数量上限，0 表示不限
+	int threads = 0;          // 工作线程数，0 表示使用 TBB 默认值
+};
+
+/**
+ * @brief 精确覆盖拼图求解器
+ * 用给定拼图块（每块最多使用一次）恰好覆盖棋盘上所有 AVAILABLE 格子。
+ *
+ * 每种形状的所有旋转/翻转在所有位置上的放置预先计算为 64 位掩码，
+ * 按掩码最低位连续存放在同一数组中；搜索时总是填充剩余目标中编号最小的格子，
+ * 只需尝试以该格为最低位的放置，每步仅为几次位运算。
+ * 放置后若周围留下小于最小拼图块的孤立区域则跳过该放置（随时求解除外）。
+ * 形状相同的拼图块合并计数，避免对称的重复搜索。
+ *
+ * 设置置换表后，搜索状态（剩余目标格、每种形状的剩余数量、棋盘尺寸）按 Zobrist 哈希增量维护，
+ * 已证明有解/无解的子状态写入表中；表跨次求解保留，相邻两帧的棋盘只差几个格子时，
+ * 重新求解的大部分子状态直接命中。
+ *
+ * 棋盘尺寸为 5x6、6x6、8x8 时，不带置换表与进度回调的 solve 由 BoardSearch<Rows, Cols> 完成，
+ * 同样的剪枝在编译期尺寸上展开。SolverService 总是带置换表，Pipeline 经由它或 solveAnytime 求解，
+ * 因此实际的求解路径不经过 BoardSearch，而是上面带区域剪枝的通用搜索。
+ */
+class PuzzleSolver {
+public:
+	// 搜索中使用的放置：形状编号与掩码
+	struct Move {
+		int shape;
+		uint64_t mask;
+	};
+
+	explicit PuzzleSolver(const std::vector<PuzzlePiece>& pieces, bool allowReflection = true);
+
+	// 由 analyzeGrid 的输出构建位棋盘
+	static bool boardFromCells(const std::vector<CellInfo>& cells, Bitboard& board);
+
+	bool solve(const std::vector<CellInfo>& cells, PuzzleSolution& outSolution);
+	bool solve(const Bitboard& board, PuzzleSolution& outSolution);
+	// 只使用 available 中列出的拼图块（索引），用于对局中途已有拼图块被放下的情况
+	bool solve(const Bitboard& board, const std::vector<int>& available, PuzzleSolution& outSolution);
+
+	// 搜索中已覆盖格数创新高时以当前的部分放置回调
+	typedef std::function<void(const PuzzleSolution& partial, int covered)> ProgressFunc;
+	/**
+	 * @brief 可中断求解
+	 * 与 solve 相同的完整搜索，cancel 置位后尽快返回 false；
+	 * 搜索过程中每当已覆盖的目标格数超过之前的最好值，以该部分放置调用 onProgress，
+	 * 调用方据此在时间用完时取得目前最好的结果。
+	 * 只能排除完整解的剪枝（格数上界、置换表中的无解记录）在这里不使用，
+	 * 否则已证明无解的棋盘再次求解时在根节点返回，得不到任何部分放置。
+	 * @param available 可用的拼图块索引，nullptr 表示全部
+	 * @param liveNodes 非空时搜索过程中每 1024 个节点写入一次本次已访问的节点数，可在其他线程读取
+	 */
+	bool solveAnytime(const Bitboard& board, const std::vector<int>* available, const std::atomic<bool>& cancel, const ProgressFunc& onProgress, PuzzleSolution& outSolution,
+		std::atomic<uint64_t>* liveNodes = nullptr);
+
+	/**
+	 * @brief 并行求解
+	 * 搜索树前 splitDepth 层的每个分支作为一个任务交给 TBB 的工作窃取调度器，
+	 * 更深的部分在任务内串行搜索。找到第一个解（或达到解数量上限）后取消其余任务。
+	 * @return 是否至少找到一个解
+	 */
+	bool solveParallel(const Bitboard& board, std::vector<PuzzleSolution>& outSolutions, const ParallelSolveOptions& options = ParallelSolveOptions());
+	bool solveParallel(const std::vector<CellInfo>& cells, std::vector<PuzzleSolution>& outSolutions, const ParallelSolveOptions& options = ParallelSolveOptions());
+
+	/**
+	 * @brief 设置置换表
+	 * 表由调用方持有，可被多个拼图块集合相同的求解器共享；传入 nullptr 关闭。
+	 * solveParallel 的所有任务共享同一张表；枚举所有解（findAll）时只使用无解记录剪枝。
+	 */
+	void setTranspositionTable(TranspositionTable* table) { m_table = table; }
+	TranspositionTable* transpositionTable() const { return m_table; }
+
+	// 关闭后支持的尺寸也使用通用搜索（默认开启），用于对比两者的节点数与耗时
+	void setFixedSizeSearch(bool enabled) { m_useFixed = enabled; }
+
+	const std::vector<PuzzlePiece>& pieces() const { return m_pieces; }
+	// 上次求解访问的搜索节点数
+	uint64_t nodes() const { return m_nodes; }
+	// 上次求解的置换表查询与命中次数
+	uint64_t tableProbes() const { return m_tableProbes; }
+	uint64_t tableHits() const { return m_tableHits; }
+
+private:
+	// 单条搜索路径的状态，每个并行任务各持一份
+	struct SearchState {
+		std::vector<int> shapeCount; // 每种形状剩余可用数量
+		std::vector<Move> path;
+		uint64_t nodes = 0;
+		uint64_t probes = 0;
+		uint64_t hits = 0;
+		const std::atomic<bool>* cancel = nullptr;
+		std::atomic<uint64_t>* liveNodes = nullptr;
+		// 部分放置进度：目标格总数、目前最多覆盖的格数与回调
+		int targetCells = 0;
+		int bestCovered = -1;
+		const std::function<void(const std::vector<Move>&, int)>* onProgress = nullptr;
+	};
+	enum class SearchResult {
+		FOUND,
+		NONE,
+		CANCELLED
+	};
+	// 返回 true 表示停止搜索
+	typedef std::function<bool(const std::vector<Move>&)> SolutionVisitor;
+
+	bool prepare(int rows, int cols);
+	bool solveShapes(const Bitboard& board, const std::vector<std::vector<int>>& shapePieces, PuzzleSolution& outSolution,
+		const std::atomic<bool>* cancel = nullptr, const ProgressFunc* onProgress = nullptr, std::atomic<uint64_t>* liveNodes = nullptr);
+	bool availableShapes(const std::vector<int>& available, std::vector<std::vector<int>>& shapePieces) const;
+	void reportProgress(uint64_t remaining, SearchState& state) const;
+	// 每 1024 个节点调用一次：发布已访问节点数，返回是否已取消
+	static bool checkpoint(const SearchState& state);
+	SearchState initialState(const std::vector<std::vector<int>>& shapePieces, int& pieceCells) const;
+	bool search(uint64_t remaining, int pieceCells, SearchState& state, const SolutionVisitor& onSolution) const;
+	// 带置换表的搜索，只找第一个解；返回 FOUND 时 state.path 为完整的解
+	SearchResult searchCached(uint64_t remaining, uint64_t hash, int pieceCells, SearchState& state) const;
+	// 带置换表的枚举：只用无解记录剪枝，子树中没有解时写入无解记录；found 返回子树中是否有解，返回 true 表示停止搜索
+	bool searchAll(uint64_t remaining, uint64_t hash, int pieceCells, SearchState& state, const SolutionVisitor& onSolution, bool& found) const;
+	uint64_t stateHash(uint64_t remaining, const std::vector<int>& shapeCount) const;
+	std::span<const Move> movesAt(int cell) const;
+	// 四邻域扩张一步（不含自身）
+	uint64_t neighbors(uint64_t mask) const;
+	// 放置 placed 后，remaining 中与其相邻的连通区域是否有小于最小拼图块的（这样的分支没有完整解）
+	bool isolates(uint64_t remaining, uint64_t placed) const;
+	uint64_t cellsKey(uint64_t mask) const;
+	void toSolution(const Bitboard& board, const std::vector<Move>& path, const std::vector<std::vector<int>>& shapePieces, PuzzleSolution& outSolution) const;
+
+	std::vector<PuzzlePiece> m_pieces;
+	bool m_allowReflection;
+
+	std::vector<std::vector<std::pair<int, int>>> m_shapes; // 规范化后的不同形状
+	std::vector<std::vector<int>> m_shapePieces;           // 每种形状对应的拼图块索引
+	std::vector<int> m_pieceShape;                         // 每个拼图块的形状编号，空拼图块为 -1
+
+	// Zobrist 键：每个格子、每种形状的每个剩余数量、每种棋盘尺寸
+	uint64_t m_cellKeys[64];
+	std::vector<std::vector<uint64_t>> m_countKeys;
+	uint64_t m_sizeKey = 0;
+	TranspositionTable* m_table = nullptr;
+
+	int m_rows = 0;
+	int m_cols = 0;
+	std::vector<Move> m_moves;                    // 全部放置，按最低位格子连续存放
+	std::vector<uint32_t> m_moveOffsets;          // 以 cell 为最低位的放置位于 [m_moveOffsets[cell], m_moveOffsets[cell + 1])
+	uint64_t m_full = 0;                          // 当前尺寸的全部格子
+	uint64_t m_firstCol = 0;                      // 第一列 / 最后一列，邻域扩张时防止跨行
+	uint64_t m_lastCol = 0;
+	int m_minShapeSize = 1;
+	std::unique_ptr<BoardSearchBase> m_fixed;     // 当前尺寸的固定尺寸搜索，尺寸不支持时为空
+	bool m_useFixed = true;
+	uint64_t m_nodes = 0;
+	uint64_t m_tableProbes = 0;
+	uint64_t m_tableHits = 0;
+};
@@ -1,5 +1,8 @@
+#ifdef _WIN32
+
 #include "ScreenCapture.h"
 #include "utils.h"
+#include "Metrics.h"
 #include <windows.h>
 #include <iostream>
 
@@ -34,6 +37,7 @@ bool CaptureGameWindow(const std::string& windowName, cv::Mat& frame) {
  * 如果PrintWindow不可用或失败，将回退到BitBlt方法。
  */
 bool CaptureWindowComplete(void* hwnd, cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureWindowComplete");
     HWND hWnd = reinterpret_cast<HWND>(hwnd);
     
     // 检查窗口句柄有效性
@@ -193,6 +197,7 @@ bool CaptureWindowComplete(void* hwnd, cv::Mat& frame) {
  * @return 是否成功捕获
  */
 bool CaptureScreenRegion(int x, int y, int width, int height, cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureScreenRegion");
     // 参数验证
     if (width <= 0 || height <= 0) {
         std::cerr << "Error: Invalid capture region size: " << width << "x" << height << std::endl;
@@ -284,4 +289,156 @@ bool GetScreenSize(int& width, int& height) {
     }
     
     return true;
-}
\ No newline at end of file
+}
+
+struct CaptureSession::Impl {
+    HWND hwnd = nullptr;         // 为空表示捕获屏幕区域
+    HDC hSourceDC = nullptr;
+    HDC hMemoryDC = nullptr;
+    HBITMAP hBitmap = nullptr;
+    HGDIOBJ hOldBitmap = nullptr;
+    void* bits = nullptr;        // DIB Section 像素缓冲区
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+CaptureSession::CaptureSession() = default;
+
+CaptureSession::~CaptureSession() {
+    close();
+}
+
+bool CaptureSession::isOpen() const {
+    return m_impl != nullptr;
+}
+
+void CaptureSession::close() {
+    if (!m_impl) {
+        return;
+    }
+    if (m_impl->hMemoryDC != nullptr) {
+        if (m_impl->hOldBitmap != nullptr) {
+            SelectObject(m_impl->hMemoryDC, m_impl->hOldBitmap);
+        }
+        DeleteDC(m_impl->hMemoryDC);
+    }
+    if (m_impl->hBitmap != nullptr) {
+        DeleteObject(m_impl->hBitmap);
+    }
+    if (m_impl->hSourceDC != nullptr) {
+        ReleaseDC(m_impl->hwnd, m_impl->hSourceDC);
+    }
+    m_impl.reset();
+}
+
+/**
+ * @brief 创建会话使用的设备上下文和 DIB Section
+ * DIB Section 的像素内存由 GDI 分配并在会话期间保持不变，grab 直接在其上构造 Mat 视图。
+ */
+static bool createSessionBuffers(HWND hwnd, int width, int height, HDC& hSourceDC, HDC& hMemoryDC, HBITMAP& hBitmap, HGDIOBJ& hOldBitmap, void*& bits) {
+    hSourceDC = GetDC(hwnd);
+    if (hSourceDC == nullptr) {
+        std::cerr << "Error: Cannot get device context" << std::endl;
+        return false;
+    }
+
+    hMemoryDC = CreateCompatibleDC(hSourceDC);
+    if (hMemoryDC == nullptr) {
+        std::cerr << "Error: Cannot create memory device context" << std::endl;
+        return false;
+    }
+
+    BITMAPINFO bmi = {0};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height; // top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hBitmap = CreateDIBSection(hSourceDC, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (hBitmap == nullptr || bits == nullptr) {
+        std::cerr << "Error: Cannot create DIB section" << std::endl;
+        return false;
+    }
+
+    hOldBitmap = SelectObject(hMemoryDC, hBitmap);
+    if (hOldBitmap == nullptr || hOldBitmap == HGDI_ERROR) {
+        hOldBitmap = nullptr;
+        std::cerr << "Error: Cannot select bitmap into memory DC" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::open(int x, int y, int width, int height) {
+    close();
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid capture region size: " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    m_impl = std::make_unique<Impl>();
+    m_impl->x = x;
+    m_impl->y = y;
+    m_impl->width = width;
+    m_impl->height = height;
+    if (!createSessionBuffers(nullptr, width, height, m_impl->hSourceDC, m_impl->hMemoryDC, m_impl->hBitmap, m_impl->hOldBitmap, m_impl->bits)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::openWindow(void* hwnd) {
+    close();
+    HWND hWnd = reinterpret_cast<HWND>(hwnd);
+    if (!IsWindow(hWnd)) {
+        std::cerr << "Error: Invalid window handle" << std::endl;
+        return false;
+    }
+
+    RECT clientRect;
+    if (!GetClientRect(hWnd, &clientRect)) {
+        std::cerr << "Error: Cannot get window rect" << std::endl;
+        return false;
+    }
+    int width = clientRect.right - clientRect.left;
+    int height = clientRect.bottom - clientRect.top;
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid window size: " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    m_impl = std::make_unique<Impl>();
+    m_impl->hwnd = hWnd;
+    m_impl->width = width;
+    m_impl->height = height;
+    if (!createSessionBuffers(hWnd, width, height, m_impl->hSourceDC, m_impl->hMemoryDC, m_impl->hBitmap, m_impl->hOldBitmap, m_impl->bits)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::grab(cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureSession.grab");
+    if (!m_impl) {
+        std::cerr << "Error: Capture session is not open" << std::endl;
+        return false;
+    }
+
+    if (!BitBlt(m_impl->hMemoryDC, 0, 0, m_impl->width, m_impl->height, m_impl->hSourceDC, m_impl->x, m_impl->y, SRCCOPY)) {
+        std::cerr << "Error: Cannot copy screen content to memory" << std::endl;
+        return false;
+    }
+    // 确保 GDI 已完成对 DIB 内存的写入
+    GdiFlush();
+
+    frame = cv::Mat(m_impl->height, m_impl->width, CV_8UC4, m_impl->bits);
+    return true;
+}
+
+#endif // _WIN32
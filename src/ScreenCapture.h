@@ -1,6 +1,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <string>
 
 /**
@@ -13,6 +14,9 @@
  * 3. 捕获指定屏幕区域
  *
  * 所有捕获操作均返回OpenCV的Mat格式图像，便于后续图像处理
+ *
+ * Windows 下基于 GDI 实现，Linux 下基于 X11（XShm）实现，接口一致；
+ * Linux 下窗口句柄参数为 X11 的 Window ID。
  */
 
  /**
@@ -57,4 +61,55 @@ bool CaptureWindowComplete(void* hwnd, cv::Mat& frame);
  * @param height 屏幕高度（输出参数）
  * @return 是否成功获取
  */
-bool GetScreenSize(int& width, int& height);
\ No newline at end of file
+bool GetScreenSize(int& width, int& height);
+
+/**
+ * @brief 持久化捕获会话
+ *
+ * 打开时一次性分配捕获缓冲区（Linux 下为 XShm 共享内存段，Windows 下为 DIB Section），
+ * 之后每次 grab 只把屏幕内容拷入该缓冲区，并返回直接指向它的 BGRA 视图，
+ * 每帧不分配内存、不做颜色转换，可按显示刷新率连续捕获。
+ *
+ * 会话持有自己的显示连接，只能在单个线程中使用。
+ */
+class CaptureSession {
+public:
+    CaptureSession();
+    ~CaptureSession();
+    CaptureSession(const CaptureSession&) = delete;
+    CaptureSession& operator=(const CaptureSession&) = delete;
+
+    /**
+     * @brief 打开屏幕区域捕获
+     * @param x 区域左上角x坐标
+     * @param y 区域左上角y坐标
+     * @param width 区域宽度
+     * @param height 区域高度
+     * @return 是否成功
+     */
+    bool open(int x, int y, int width, int height);
+
+    /**
+     * @brief 打开窗口捕获（窗口当前尺寸）
+     * @param hwnd 窗口句柄（Linux 下为 X11 Window ID）
+     * @return 是否成功
+     *
+     * 窗口尺寸变化后 grab 会失败，需要重新打开。
+     */
+    bool openWindow(void* hwnd);
+
+    void close();
+    bool isOpen() const;
+
+    /**
+     * @brief 捕获一帧
+     * @param frame 输出 CV_8UC4（BGRA）图像，直接引用会话内部缓冲区，
+     *              在下一次 grab 或 close 之前有效；需要长期保存时请 clone
+     * @return 是否成功捕获
+     */
+    bool grab(cv::Mat& frame);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
@@ -0,0 +1,406 @@
+#if defined(__linux__)
+
+#include "ScreenCapture.h"
+#include "utils.h"
+#include "Metrics.h"
+#include <iostream>
+#include <mutex>
+#include <cstdint>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+/**
+ * X11 后端
+ * 单次捕获函数使用 XGetImage；CaptureSession 使用 XShm 共享内存段，
+ * 服务器直接把像素写入段内，grab 返回指向该段的零拷贝 Mat 视图。
+ * 需要 24/32 位 TrueColor 显示（包括 Xvfb -screen 0 WxHx24）。
+ */
+
+// X 错误默认会终止进程，这里只记录下来由调用方检查
+static thread_local bool t_xError = false;
+
+static int recordXError(Display*, XErrorEvent*) {
+    t_xError = true;
+    return 0;
+}
+
+static void installErrorHandler() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        XSetErrorHandler(recordXError);
+    });
+}
+
+static std::mutex g_displayMutex;
+
+/**
+ * @brief 单次捕获使用的共享显示连接
+ * 多线程调用由 g_displayMutex 串行化
+ */
+static Display* sharedDisplay() {
+    static std::once_flag once;
+    static Display* display = nullptr;
+    std::call_once(once, []() {
+        installErrorHandler();
+        display = XOpenDisplay(nullptr);
+    });
+    if (display == nullptr) {
+        std::cerr << "Error: Cannot open X display" << std::endl;
+    }
+    return display;
+}
+
+/**
+ * @brief 将 XImage 转换为 BGR 输出
+ * 仅支持 32 位像素（BGRX 内存布局）
+ */
+static bool ximageToFrame(XImage* image, cv::Mat& frame) {
+    if (image->bits_per_pixel != 32) {
+        std::cerr << "Error: Unsupported X image depth: " << image->bits_per_pixel << std::endl;
+        return false;
+    }
+    cv::Mat rawImage(image->height, image->width, CV_8UC4, image->data, image->bytes_per_line);
+    cv::cvtColor(rawImage, frame, cv::COLOR_BGRA2BGR);
+    return true;
+}
+
+// 按窗口标题或类名在窗口树中查找（对应 Win32 下 FindWindow 的两次查找）
+static Window findWindowByName(Display* display, Window root, const std::string& name, bool byClass) {
+    if (byClass) {
+        XClassHint hint;
+        if (XGetClassHint(display, root, &hint)) {
+            bool match = (hint.res_class && name == hint.res_class) || (hint.res_name && name == hint.res_name);
+            if (hint.res_name) XFree(hint.res_name);
+            if (hint.res_class) XFree(hint.res_class);
+            if (match) {
+                return root;
+            }
+        }
+    }
+    else {
+        char* windowName = nullptr;
+        if (XFetchName(display, root, &windowName) && windowName) {
+            bool match = name == windowName;
+            XFree(windowName);
+            if (match) {
+                return root;
+            }
+        }
+    }
+
+    Window rootReturn, parentReturn;
+    Window* children = nullptr;
+    unsigned int count = 0;
+    if (!XQueryTree(display, root, &rootReturn, &parentReturn, &children, &count)) {
+        return 0;
+    }
+    Window found = 0;
+    for (unsigned int i = 0; i < count && found == 0; i++) {
+        found = findWindowByName(display, children[i], name, byClass);
+    }
+    if (children) {
+        XFree(children);
+    }
+    return found;
+}
+
+/**
+ * @brief 捕获指定窗口的内容
+ * @param windowName 窗口名称
+ * @param frame 输出的帧图像
+ * @return 是否成功捕获
+ */
+bool CaptureGameWindow(const std::string& windowName, cv::Mat& frame) {
+    Display* display = sharedDisplay();
+    if (display == nullptr) {
+        return false;
+    }
+
+    Window window;
+    {
+        std::lock_guard<std::mutex> lock(g_displayMutex);
+        Window root = DefaultRootWindow(display);
+        window = findWindowByName(display, root, windowName, false);
+        if (window == 0) {
+            window = findWindowByName(display, root, windowName, true);
+        }
+    }
+
+    if (window == 0) {
+        std::cerr << "Error: Cannot find window: " << windowName << std::endl;
+        return false;
+    }
+
+    return CaptureWindowComplete(reinterpret_cast<void*>(static_cast<uintptr_t>(window)), frame);
+}
+
+/**
+ * @brief 根据窗口 ID 捕获窗口内容
+ * @param hwnd X11 Window ID
+ * @param frame 输出的帧图像
+ * @return 是否成功捕获
+ */
+bool CaptureWindowComplete(void* hwnd, cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureWindowComplete");
+    Display* display = sharedDisplay();
+    if (display == nullptr) {
+        return false;
+    }
+    Window window = static_cast<Window>(reinterpret_cast<uintptr_t>(hwnd));
+
+    std::lock_guard<std::mutex> lock(g_displayMutex);
+    t_xError = false;
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(display, window, &attributes) || t_xError) {
+        std::cerr << "Error: Invalid window handle" << std::endl;
+        return false;
+    }
+    if (attributes.width <= 0 || attributes.height <= 0 || attributes.map_state != IsViewable) {
+        std::cerr << "Error: Window is not viewable" << std::endl;
+        return false;
+    }
+
+    XImage* image = XGetImage(display, window, 0, 0, attributes.width, attributes.height, AllPlanes, ZPixmap);
+    if (image == nullptr || t_xError) {
+        if (image) XDestroyImage(image);
+        std::cerr << "Error: XGetImage failed" << std::endl;
+        return false;
+    }
+
+    bool ok = ximageToFrame(image, frame);
+    XDestroyImage(image);
+    if (ok) {
+        saveImage(frame, "screen_shot.png", "./screen");
+    }
+    return ok;
+}
+
+/**
+ * @brief 捕获指定区域的屏幕内容
+ * @param x 截图区域左上角x坐标
+ * @param y 截图区域左上角y坐标
+ * @param width 截图区域宽度
+ * @param height 截图区域高度
+ * @param frame 输出的帧图像
+ * @return 是否成功捕获
+ */
+bool CaptureScreenRegion(int x, int y, int width, int height, cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureScreenRegion");
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid capture region size: " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    Display* display = sharedDisplay();
+    if (display == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_displayMutex);
+    t_xError = false;
+    XImage* image = XGetImage(display, DefaultRootWindow(display), x, y, width, height, AllPlanes, ZPixmap);
+    if (image == nullptr || t_xError) {
+        if (image) XDestroyImage(image);
+        std::cerr << "Error: Cannot copy screen content to memory" << std::endl;
+        return false;
+    }
+
+    bool ok = ximageToFrame(image, frame);
+    XDestroyImage(image);
+    return ok;
+}
+
+/**
+ * @brief 获取屏幕尺寸
+ * @param width 屏幕宽度（输出参数）
+ * @param height 屏幕高度（输出参数）
+ * @return 是否成功获取
+ */
+bool GetScreenSize(int& width, int& height) {
+    Display* display = sharedDisplay();
+    if (display == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_displayMutex);
+    int screen = DefaultScreen(display);
+    width = DisplayWidth(display, screen);
+    height = DisplayHeight(display, screen);
+
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Cannot get screen size" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+struct CaptureSession::Impl {
+    Display* display = nullptr;  // 会话独占的显示连接
+    Drawable drawable = 0;       // 根窗口或目标窗口
+    XImage* image = nullptr;
+    XShmSegmentInfo shm = {};
+    bool attached = false;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+CaptureSession::CaptureSession() = default;
+
+CaptureSession::~CaptureSession() {
+    close();
+}
+
+bool CaptureSession::isOpen() const {
+    return m_impl != nullptr;
+}
+
+void CaptureSession::close() {
+    if (!m_impl) {
+        return;
+    }
+    if (m_impl->attached) {
+        XShmDetach(m_impl->display, &m_impl->shm);
+        XSync(m_impl->display, False);
+    }
+    if (m_impl->image) {
+        // 像素内存属于共享内存段，不能由 XDestroyImage 释放
+        m_impl->image->data = nullptr;
+        XDestroyImage(m_impl->image);
+    }
+    if (m_impl->shm.shmaddr != nullptr && m_impl->shm.shmaddr != reinterpret_cast<char*>(-1)) {
+        shmdt(m_impl->shm.shmaddr);
+    }
+    if (m_impl->display) {
+        XCloseDisplay(m_impl->display);
+    }
+    m_impl.reset();
+}
+
+/**
+ * @brief 创建 XShm 图像与共享内存段
+ * 段在 attach 之后立即标记删除，进程异常退出时也不会遗留。
+ */
+static bool createShmImage(Display* display, int width, int height, XImage*& image, XShmSegmentInfo& shm, bool& attached) {
+    if (!XShmQueryExtension(display)) {
+        std::cerr << "Error: XShm extension is not available" << std::endl;
+        return false;
+    }
+
+    int screen = DefaultScreen(display);
+    image = XShmCreateImage(display, DefaultVisual(display, screen), DefaultDepth(display, screen), ZPixmap, nullptr, &shm, width, height);
+    if (image == nullptr) {
+        std::cerr << "Error: XShmCreateImage failed" << std::endl;
+        return false;
+    }
+    if (image->bits_per_pixel != 32) {
+        std::cerr << "Error: Unsupported X image depth: " << image->bits_per_pixel << std::endl;
+        return false;
+    }
+
+    shm.shmid = shmget(IPC_PRIVATE, static_cast<size_t>(image->bytes_per_line) * image->height, IPC_CREAT | 0600);
+    if (shm.shmid < 0) {
+        std::cerr << "Error: shmget failed" << std::endl;
+        return false;
+    }
+    shm.shmaddr = image->data = static_cast<char*>(shmat(shm.shmid, nullptr, 0));
+    if (shm.shmaddr == reinterpret_cast<char*>(-1)) {
+        shmctl(shm.shmid, IPC_RMID, nullptr);
+        image->data = nullptr;
+        std::cerr << "Error: shmat failed" << std::endl;
+        return false;
+    }
+    shm.readOnly = False;
+
+    t_xError = false;
+    attached = XShmAttach(display, &shm) && (XSync(display, False), !t_xError);
+    shmctl(shm.shmid, IPC_RMID, nullptr);
+    if (!attached) {
+        std::cerr << "Error: XShmAttach failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::open(int x, int y, int width, int height) {
+    close();
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Error: Invalid capture region size: " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    installErrorHandler();
+    m_impl = std::make_unique<Impl>();
+    m_impl->display = XOpenDisplay(nullptr);
+    if (m_impl->display == nullptr) {
+        std::cerr << "Error: Cannot open X display" << std::endl;
+        m_impl.reset();
+        return false;
+    }
+    m_impl->drawable = DefaultRootWindow(m_impl->display);
+    m_impl->x = x;
+    m_impl->y = y;
+    m_impl->width = width;
+    m_impl->height = height;
+
+    if (!createShmImage(m_impl->display, width, height, m_impl->image, m_impl->shm, m_impl->attached)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::openWindow(void* hwnd) {
+    close();
+
+    installErrorHandler();
+    m_impl = std::make_unique<Impl>();
+    m_impl->display = XOpenDisplay(nullptr);
+    if (m_impl->display == nullptr) {
+        std::cerr << "Error: Cannot open X display" << std::endl;
+        m_impl.reset();
+        return false;
+    }
+
+    Window window = static_cast<Window>(reinterpret_cast<uintptr_t>(hwnd));
+    t_xError = false;
+    XWindowAttributes attributes;
+    if (!XGetWindowAttributes(m_impl->display, window, &attributes) || t_xError) {
+        std::cerr << "Error: Invalid window handle" << std::endl;
+        close();
+        return false;
+    }
+    m_impl->drawable = window;
+    m_impl->width = attributes.width;
+    m_impl->height = attributes.height;
+
+    if (!createShmImage(m_impl->display, attributes.width, attributes.height, m_impl->image, m_impl->shm, m_impl->attached)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureSession::grab(cv::Mat& frame) {
+    SNOW_SCOPED_TIMER("CaptureSession.grab");
+    if (!m_impl) {
+        std::cerr << "Error: Capture session is not open" << std::endl;
+        return false;
+    }
+
+    t_xError = false;
+    if (!XShmGetImage(m_impl->display, m_impl->drawable, m_impl->image, m_impl->x, m_impl->y, AllPlanes) || t_xError) {
+        std::cerr << "Error: XShmGetImage failed" << std::endl;
+        return false;
+    }
+
+    frame = cv::Mat(m_impl->height, m_impl->width, CV_8UC4, m_impl->image->data, m_impl->image->bytes_per_line);
+    return true;
+}
+
+#endif // __linux__
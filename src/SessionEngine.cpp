@@ -0,0 +1,240 @@
+#include "SessionEngine.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+shared_ptr<const SharedAssets> SharedAssets::load(const vector<string>& paths) {
+	auto assets = make_shared<SharedAssets>();
+	for (const auto& path : paths) {
+		int index = assets->templates.load(path, path);
+		if (index < 0 || assets->histograms.add(path, assets->templates.image(index)) < 0) {
+			cerr << "load template failed: " << path << endl;
+			return nullptr;
+		}
+	}
+	return assets;
+}
+
+size_t SharedAssets::bytes() const {
+	return templates.bytes() + histograms.size() * sizeof(HsHistogram);
+}
+
+size_t SessionEngine::residentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	// /proc/self/statm 的第二项为常驻页数
+	ifstream statm("/proc/self/statm");
+	size_t pages = 0, resident = 0;
+	if (!(statm >> pages >> resident)) {
+		return 0;
+	}
+	return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+SessionEngine::SessionEngine(shared_ptr<const SharedAssets> assets, const EngineOptions& options)
+	: m_assets(assets ? std::move(assets) : make_shared<const SharedAssets>()), m_options(options) {
+	m_baselineBytes = residentBytes();
+}
+
+SessionEngine::~SessionEngine() {
+	stop();
+}
+
+int SessionEngine::addSession(unique_ptr<FrameSource> source, ResultFunc onResult) {
+	if (m_running) {
+		cerr << "SessionEngine is running; add sessions before start()" << endl;
+		return -1;
+	}
+	auto session = make_unique<Session>();
+	session->source = std::move(source);
+	session->onResult = std::move(onResult);
+	m_sessions.push_back(std::move(session));
+	return static_cast<int>(m_sessions.size()) - 1;
+}
+
+bool SessionEngine::start() {
+	if (m_running) {
+		return true;
+	}
+	if (m_sessions.empty()) {
+		cerr << "SessionEngine has no sessions" << endl;
+		return false;
+	}
+
+	// 不为调用线程保留槽位，全部 threads 个线程都是竞技场的工作线程，调用方不进入 wait 时也满速运行
+	m_threads = m_options.threads > 0 ? m_options.threads : static_cast<int>(std::max(1u, thread::hardware_concurrency()));
+	if (m_arena.is_active()) {
+		m_arena.terminate();
+	}
+	m_arena.initialize(m_threads, 0);
+
+	vector<int> ready;
+	for (size_t i = 0; i < m_sessions.size(); i++) {
+		if (!m_sessions[i]->finished.load(memory_order_relaxed)) {
+			ready.push_back(static_cast<int>(i));
+		}
+	}
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_start = chrono::steady_clock::now();
+		m_end = ready.empty() ? m_start : chrono::steady_clock::time_point();
+	}
+	m_active = static_cast<int>(ready.size());
+	m_running = true;
+	for (int index : ready) {
+		schedule(index);
+	}
+	return true;
+}
+
+void SessionEngine::stop() {
+	if (!m_running.exchange(false)) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_end == chrono::steady_clock::time_point()) {
+			m_end = chrono::steady_clock::now();
+		}
+	}
+	// 正在处理的帧完成后不再入队，等待它们结束
+	m_arena.execute([this]() { m_group.wait(); });
+}
+
+void SessionEngine::wait() {
+	if (m_arena.is_active()) {
+		m_arena.execute([this]() { m_group.wait(); });
+	}
+}
+
+void SessionEngine::schedule(int index) {
+	// enqueue 的任务进入竞技场的共享队列，排在其他会话已入队的任务之后；
+	// task_group::run 则放入当前线程的本地栈，同一线程会立刻取回刚放入的任务，饿死其他会话
+	m_arena.enqueue(m_group.defer([this, index]() { step(index); }));
+}
+
+void SessionEngine::step(int index) {
+	bool more = process(index);
+	if (more) {
+		if (m_running.load(memory_order_acquire)) {
+			schedule(index);
+		}
+		return;
+	}
+	m_sessions[index]->finished.store(true, memory_order_relaxed);
+	if (m_active.fetch_sub(1, memory_order_acq_rel) == 1) {
+		lock_guard<mutex> lock(m_mutex);
+		m_end = chrono::steady_clock::now();
+	}
+}
+
+bool SessionEngine::process(int index) {
+	SNOW_SCOPED_TIMER("SessionEngine.frame");
+	Session& s = *m_sessions[index];
+	auto start = chrono::steady_clock::now();
+	if (!s.source->read(s.frame)) {
+		// 实时捕获偶尔失败时稍后重试，离线数据源读完则结束会话
+		if (s.source->finished()) {
+			return false;
+		}
+		this_thread::sleep_for(chrono::milliseconds(1));
+		return true;
+	}
+
+	// 本帧的灰度图、边缘图等在网格分析内共享，模板库只读共享
+	s.cells.clear();
+	s.planes.reset(s.frame);
+	bool gridFound = m_options.incremental ? s.analyzer.analyze(s.planes, s.cells) : analyzeGrid(s.planes, s.cells, GridLayout(), s.context);
+	s.planes.clear();
+	s.matches.clear();
+	if (m_options.matchTemplates && !m_assets->templates.empty()) {
+		m_assets->templates.matchAll(s.frame, s.matches);
+	}
+
+	if (s.onResult) {
+		SessionFrame result;
+		result.session = index;
+		result.frameIndex = s.frameIndex;
+		result.frame = &s.frame;
+		result.gridFound = gridFound;
+		result.cells = &s.cells;
+		result.matches = &s.matches;
+		s.onResult(result);
+	}
+	s.frameIndex++;
+	s.frames.fetch_add(1, memory_order_relaxed);
+	s.gridFound.fetch_add(gridFound, memory_order_relaxed);
+	s.busyNanos.fetch_add(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()), memory_order_relaxed);
+	return true;
+}
+
+SessionStats SessionEngine::sessionStats(int session) const {
+	SessionStats s;
+	const Session& state = *m_sessions[session];
+	s.frames = state.frames.load(memory_order_relaxed);
+	s.gridFound = state.gridFound.load(memory_order_relaxed);
+	s.busyMs = state.busyNanos.load(memory_order_relaxed) / 1e6;
+	s.finished = state.finished.load(memory_order_relaxed);
+	return s;
+}
+
+EngineStats SessionEngine::stats() const {
+	EngineStats s;
+	s.sessions = static_cast<int>(m_sessions.size());
+	s.threads = m_threads;
+	s.cores = std::max(1u, thread::hardware_concurrency());
+
+	uint64_t minFrames = UINT64_MAX, maxFrames = 0;
+	for (const auto& session : m_sessions) {
+		uint64_t frames = session->frames.load(memory_order_relaxed);
+		s.frames += frames;
+		minFrames = std::min(minFrames, frames);
+		maxFrames = std::max(maxFrames, frames);
+	}
+	s.fairness = maxFrames > 0 ? static_cast<double>(minFrames) / maxFrames : 1.0;
+
+	{
+		// 全部会话结束或 stop 之后按结束时刻计算
+		lock_guard<mutex> lock(m_mutex);
+		if (m_start != chrono::steady_clock::time_point()) {
+			auto end = m_end != chrono::steady_clock::time_point() ? m_end : chrono::steady_clock::now();
+			s.seconds = chrono::duration<double>(end - m_start).count();
+		}
+	}
+	s.framesPerSecond = s.seconds > 0 ? s.frames / s.seconds : 0;
+	// 吞吐量由 min(线程数, 核心数) 个核心提供
+	int usedCores = std::min(std::max(s.threads, 1), static_cast<int>(s.cores));
+	s.sessionsPerCore = m_options.targetFps > 0 ? s.framesPerSecond / m_options.targetFps / usedCores : 0;
+
+	s.sharedBytes = m_assets->bytes();
+	s.residentBytes = residentBytes();
+	// 预取线程与环形缓冲区属于数据源，不计入会话本身
+	for (const auto& session : m_sessions) {
+		s.sourceThreads += session->source->backgroundThreads();
+		s.sourceBytes += session->source->bufferBytes();
+	}
+	size_t engineBytes = s.residentBytes > m_baselineBytes ? s.residentBytes - m_baselineBytes : 0;
+	engineBytes -= std::min(engineBytes, s.sourceBytes);
+	if (s.sessions > 0) {
+		s.bytesPerSession = engineBytes / s.sessions;
+	}
+	return s;
+}
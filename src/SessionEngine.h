@@ -0,0 +1,158 @@
+#pragma once
+
+#include "recognition.h"
+#include "TemplateBank.h"
+#include "HistogramEngine.h"
+#include "FrameSource.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
+/**
+ * @brief 所有会话共享的只读资源
+ * 模板文件只读取一次，模板库与直方图库同时建立；加载完成后不再修改，
+ * 以 shared_ptr<const SharedAssets> 在会话与引擎之间共享，多线程同时读取无需加锁。
+ */
+struct SharedAssets {
+	TemplateBank templates;
+	HistogramBank histograms;
+
+	// 按路径加载模板（名称即路径），任一文件失败返回空指针
+	static std::shared_ptr<const SharedAssets> load(const std::vector<std::string>& paths);
+
+	// 模板图像、频谱与直方图占用的字节数
+	size_t bytes() const;
+};
+
+// 引擎参数
+struct EngineOptions {
+	int threads = 0;          // 任务竞技场的线程数，0 表示使用全部核心
+	bool incremental = true;  // 会话使用 GridAnalyzer 增量分析
+	bool matchTemplates = true; // 共享模板库非空时每帧批量模板匹配
+	double targetFps = 30;    // 估算每核会话数时每个会话需要达到的帧率
+};
+
+/**
+ * @brief 一个会话的一帧结果，只在回调期间有效
+ */
+struct SessionFrame {
+	int session = 0;
+	uint64_t frameIndex = 0;
+	const cv::Mat* frame = nullptr;
+	bool gridFound = false;
+	const std::vector<CellInfo>* cells = nullptr;
+	const std::vector<TemplateMatchResult>* matches = nullptr;
+};
+
+// 单个会话的统计
+struct SessionStats {
+	uint64_t frames = 0;       // 处理的帧数
+	uint64_t gridFound = 0;    // 找到网格的帧数
+	double busyMs = 0;         // 读取、识别与回调的累计耗时
+	bool finished = false;     // 数据源已读完
+};
+
+// 引擎统计
+struct EngineStats {
+	int sessions = 0;
+	int threads = 0;
+	unsigned cores = 0;
+	uint64_t frames = 0;             // 全部会话处理的帧数
+	double seconds = 0;              // 自 start 起的时间
+	double framesPerSecond = 0;      // 全部会话合计
+	double sessionsPerCore = 0;      // 以当前吞吐量按 targetFps 估算，每个核心可承载的会话数
+	double fairness = 0;             // 各会话处理帧数的最小值 / 最大值，1 表示完全均衡
+	size_t sharedBytes = 0;          // 共享资源占用
+	size_t residentBytes = 0;        // 进程常驻内存
+	int sourceThreads = 0;           // 数据源自带的后台线程（离线数据源的预取线程）
+	size_t sourceBytes = 0;          // 数据源自带的缓冲区（预取环形缓冲区）
+	size_t bytesPerSession = 0;      // (常驻内存 - 引擎创建时的常驻内存 - sourceBytes) / 会话数
+};
+
+/**
+ * @brief 多会话识别引擎
+ *
+ * 一个进程内承载 N 个相互独立的会话，每个会话有自己的数据源与网格分析状态，
+ * 模板库与直方图库由所有会话共享。会话不绑定线程：每个会话同一时刻只有一个任务，
+ * 处理一帧后把下一帧的任务 enqueue 回 tbb::task_arena，竞技场按大致先进先出的顺序执行，
+ * 因此各会话轮流获得处理时间，不会因某个数据源更快而饿死其他会话。
+ *
+ * 实时捕获数据源的 read 会阻塞工作线程直到取得画面，线程数应不少于实时会话数。
+ * 离线数据源的预取线程与环形缓冲区不属于引擎，单独统计在 sourceThreads / sourceBytes 中。
+ */
+class SessionEngine {
+public:
+	typedef std::function<void(const SessionFrame&)> ResultFunc;
+
+	explicit SessionEngine(std::shared_ptr<const SharedAssets> assets, const EngineOptions& options = EngineOptions());
+	~SessionEngine();
+
+	SessionEngine(const SessionEngine&) = delete;
+	SessionEngine& operator=(const SessionEngine&) = delete;
+
+	/**
+	 * @brief 添加会话，须在 start 之前调用
+	 * @param onResult 每帧完成后在工作线程中调用，同一会话的回调不会并发
+	 * @return 会话编号
+	 */
+	int addSession(std::unique_ptr<FrameSource> source, ResultFunc onResult = ResultFunc());
+
+	bool start();
+	void stop();
+	// 等待全部会话的数据源读完（实时捕获的会话需调用 stop 结束）
+	void wait();
+
+	size_t sessionCount() const { return m_sessions.size(); }
+	const SharedAssets& assets() const { return *m_assets; }
+	SessionStats sessionStats(int session) const;
+	EngineStats stats() const;
+
+	// 进程当前的常驻内存（字节），不支持的平台返回 0
+	static size_t residentBytes();
+
+private:
+	struct Session {
+		std::unique_ptr<FrameSource> source;
+		ResultFunc onResult;
+		GridAnalyzer analyzer;
+		RecognitionContext context;
+		FramePlanes planes;
+		cv::Mat frame;
+		std::vector<CellInfo> cells;
+		std::vector<TemplateMatchResult> matches;
+		uint64_t frameIndex = 0;
+		std::atomic<uint64_t> frames{ 0 };
+		std::atomic<uint64_t> gridFound{ 0 };
+		std::atomic<uint64_t> busyNanos{ 0 };
+		std::atomic<bool> finished{ false };
+	};
+
+	// 把会话下一帧的任务放入竞技场队尾
+	void schedule(int index);
+	// 会话的一个任务：处理一帧，还有后续帧且引擎未停止时重新入队
+	void step(int index);
+	// 处理会话的一帧，返回数据源是否还有后续帧
+	bool process(int index);
+
+	std::shared_ptr<const SharedAssets> m_assets;
+	EngineOptions m_options;
+	std::vector<std::unique_ptr<Session>> m_sessions;
+
+	tbb::task_arena m_arena;
+	tbb::task_group m_group;          // 全部会话的任务，等待它即等待全部会话停止
+	std::atomic<bool> m_running{ false };
+	std::atomic<int> m_active{ 0 };   // 尚未结束的会话数
+
+	mutable std::mutex m_mutex;       // 保护 m_start / m_end
+	int m_threads = 0;
+	size_t m_baselineBytes = 0;
+	std::chrono::steady_clock::time_point m_start;
+	std::chrono::steady_clock::time_point m_end;
+};
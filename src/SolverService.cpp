@@ -0,0 +1,209 @@
+#include "SolverService.h"
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+SolverService::SolverService(const vector<PuzzlePiece>& pieces, size_t tableMegabytes, bool allowReflection)
+	: m_table(tableMegabytes), m_solver(pieces, allowReflection) {
+	m_solver.setTranspositionTable(&m_table);
+}
+
+SolverService::~SolverService() {
+	{
+		lock_guard<mutex> lock(m_jobMutex);
+		m_stopping = true;
+		m_cancel.store(true, memory_order_relaxed);
+	}
+	m_wakeWorker.notify_all();
+	if (m_worker.joinable()) {
+		m_worker.join();
+	}
+}
+
+bool SolverService::solve(const vector<CellInfo>& cells, PuzzleSolution& outSolution) {
+	Bitboard board;
+	if (!PuzzleSolver::boardFromCells(cells, board)) {
+		return false;
+	}
+	return solve(board, outSolution);
+}
+
+bool SolverService::solve(const Bitboard& board, PuzzleSolution& outSolution) {
+	stopBackground();
+	auto start = chrono::steady_clock::now();
+	bool found = m_solver.solve(board, outSolution);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	record(found, seconds * 1000.0);
+	recordSearch(m_solver.nodes(), m_solver.tableProbes(), m_solver.tableHits(), seconds);
+	return found;
+}
+
+bool SolverService::solve(const vector<CellInfo>& cells, const vector<int>& available, PuzzleSolution& outSolution) {
+	Bitboard board;
+	if (!PuzzleSolver::boardFromCells(cells, board)) {
+		return false;
+	}
+	stopBackground();
+	auto start = chrono::steady_clock::now();
+	bool found = m_solver.solve(board, available, outSolution);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	record(found, seconds * 1000.0);
+	recordSearch(m_solver.nodes(), m_solver.tableProbes(), m_solver.tableHits(), seconds);
+	return found;
+}
+
+bool SolverService::solveAnytime(const vector<CellInfo>& cells, chrono::steady_clock::time_point deadline, AnytimeSolution& outSolution, const vector<int>* available) {
+	Bitboard board;
+	if (!PuzzleSolver::boardFromCells(cells, board)) {
+		return false;
+	}
+	return solveAnytime(board, deadline, outSolution, available);
+}
+
+bool SolverService::solveAnytime(const Bitboard& board, chrono::steady_clock::time_point deadline, AnytimeSolution& outSolution, const vector<int>* available) {
+	auto start = chrono::steady_clock::now();
+	unique_lock<mutex> lock(m_jobMutex);
+	if (!m_worker.joinable()) {
+		m_worker = thread(&SolverService::workerLoop, this);
+	}
+
+	// 与当前任务是同一个棋盘时继续等待它，否则取消旧搜索并提交新任务
+	bool sameJob = m_jobId > 0 && board.rows == m_jobBoard.rows && board.cols == m_jobBoard.cols
+		&& board.target == m_jobBoard.target && board.blocked == m_jobBoard.blocked
+		&& (available == nullptr) == m_jobAllPieces && (available == nullptr || *available == m_jobAvailable);
+	if (!sameJob) {
+		m_cancel.store(true, memory_order_relaxed);
+		m_jobId++;
+		m_jobBoard = board;
+		m_jobAllPieces = available == nullptr;
+		m_jobAvailable = available ? *available : vector<int>();
+		m_best = AnytimeSolution();
+		m_best.target = popcount(board.target & ~board.blocked);
+		m_best.solution.rows = board.rows;
+		m_best.solution.cols = board.cols;
+		m_best.solution.complete = false;
+		m_wakeWorker.notify_one();
+	}
+
+	m_progress.wait_until(lock, deadline, [this]() { return m_best.finished; });
+	outSolution = m_best;
+	outSolution.deadlineHit = !m_best.finished;
+	lock.unlock();
+
+	bool found = outSolution.solution.complete || outSolution.covered > 0;
+	record(outSolution.solution.complete, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	{
+		lock_guard<mutex> statsLock(m_statsMutex);
+		m_stats.anytimeSolves++;
+		m_stats.deadlineHits += outSolution.deadlineHit;
+	}
+	return found;
+}
+
+void SolverService::stopBackground() {
+	unique_lock<mutex> lock(m_jobMutex);
+	if (m_busy) {
+		m_cancel.store(true, memory_order_relaxed);
+		m_progress.wait(lock, [this]() { return !m_busy; });
+	}
+	// 丢弃未开始的任务，之后的 solveAnytime 重新提交
+	m_runningId = m_jobId;
+	m_jobBoard = Bitboard();
+}
+
+void SolverService::workerLoop() {
+	while (true) {
+		uint64_t id;
+		Bitboard board;
+		bool allPieces;
+		vector<int> available;
+		{
+			unique_lock<mutex> lock(m_jobMutex);
+			m_wakeWorker.wait(lock, [this]() { return m_stopping || m_runningId != m_jobId; });
+			if (m_stopping) {
+				return;
+			}
+			id = m_runningId = m_jobId;
+			board = m_jobBoard;
+			allPieces = m_jobAllPieces;
+			available = m_jobAvailable;
+			m_cancel.store(false, memory_order_relaxed);
+			m_busy = true;
+		}
+
+		// 覆盖格数创新高时更新结果。等待中的调用方只在搜索结束或截止时间到达时返回，
+		// 到期时读取的就是这里记录的最好结果，因此不需要唤醒
+		auto onProgress = [&](const PuzzleSolution& partial, int covered) {
+			lock_guard<mutex> lock(m_jobMutex);
+			if (m_jobId == id && covered > m_best.covered) {
+				m_best.solution = partial;
+				m_best.covered = covered;
+			}
+		};
+		beginSearch();
+		auto start = chrono::steady_clock::now();
+		PuzzleSolution solution;
+		bool found = m_solver.solveAnytime(board, allPieces ? nullptr : &available, m_cancel, onProgress, solution, &m_liveNodes);
+		recordSearch(m_solver.nodes(), m_solver.tableProbes(), m_solver.tableHits(), chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+		{
+			lock_guard<mutex> lock(m_jobMutex);
+			if (m_jobId == id && !m_cancel.load(memory_order_relaxed)) {
+				m_best.finished = true;
+				if (found) {
+					m_best.solution = std::move(solution);
+					m_best.covered = m_best.target;
+				}
+			}
+			m_busy = false;
+		}
+		m_progress.notify_all();
+	}
+}
+
+void SolverService::clearTable() {
+	m_table.clear();
+}
+
+void SolverService::record(bool found, double ms) {
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.solves++;
+	m_stats.solved += found;
+	m_stats.lastMs = ms;
+	m_stats.maxMs = std::max(m_stats.maxMs, ms);
+}
+
+// 搜索本身的统计由执行搜索的线程记录（同步求解为调用线程，anytime 为工作线程）
+void SolverService::recordSearch(uint64_t nodes, uint64_t probes, uint64_t hits, double seconds) {
+	lock_guard<mutex> lock(m_statsMutex);
+	m_stats.lastNodes = nodes;
+	m_stats.totalNodes += nodes;
+	m_stats.tableProbes += probes;
+	m_stats.tableHits += hits;
+	m_stats.searchSeconds += seconds;
+	m_searchRunning = false;
+}
+
+void SolverService::beginSearch() {
+	lock_guard<mutex> lock(m_statsMutex);
+	m_liveNodes.store(0, memory_order_relaxed);
+	m_searchRunning = true;
+	m_searchStart = chrono::steady_clock::now();
+}
+
+SolverServiceStats SolverService::stats() const {
+	SolverServiceStats s;
+	{
+		lock_guard<mutex> lock(m_statsMutex);
+		s = m_stats;
+		// 一直到截止时间仍未结束的长时间搜索也要计入吞吐量
+		if (m_searchRunning) {
+			s.totalNodes += m_liveNodes.load(memory_order_relaxed);
+			s.searchSeconds += chrono::duration<double>(chrono::steady_clock::now() - m_searchStart).count();
+		}
+	}
+	s.tableOccupancy = m_table.occupancy();
+	s.nodesPerSecond = s.searchSeconds > 0 ? s.totalNodes / s.searchSeconds : 0;
+	return s;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PuzzleSolver.h"
+#include "TranspositionTable.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 求解服务统计
+ */
+struct SolverServiceStats {
+	uint64_t solves = 0;          // 求解次数
+	uint64_t solved = 0;          // 找到解的次数
+	uint64_t lastNodes = 0;       // 最近一次结束的搜索访问的节点数
+	uint64_t totalNodes = 0;      // 同步与后台搜索访问的节点总数，包括仍在进行的后台搜索（每 1024 个节点更新）
+	uint64_t tableProbes = 0;     // 累计置换表查询次数
+	uint64_t tableHits = 0;       // 累计置换表命中次数
+	double lastMs = 0;            // 最近一次求解耗时（anytime 模式为等待耗时）
+	double maxMs = 0;
+	double tableOccupancy = 0;    // 置换表占用率（抽样）
+	uint64_t anytimeSolves = 0;   // anytime 模式的调用次数
+	uint64_t deadlineHits = 0;    // 截止时间到达时搜索尚未结束的次数
+	double searchSeconds = 0;     // 同步与后台搜索的耗时总和，包括仍在进行的后台搜索
+	double nodesPerSecond = 0;    // totalNodes / searchSeconds
+};
+
+/**
+ * @brief anytime 模式的结果
+ */
+struct AnytimeSolution {
+	PuzzleSolution solution;  // 完整解（solution.complete），或目前覆盖目标格最多的部分放置
+	int covered = 0;          // 已覆盖的目标格数
+	int target = 0;           // 目标格总数
+	bool finished = false;    // 搜索已结束：找到完整解，或已证明没有完整解，结果不会再改进
+	bool deadlineHit = false; // 截止时间到达时搜索尚未结束
+};
+
+/**
+ * @brief 增量求解服务
+ *
+ * 持有一个 PuzzleSolver 与一张跨帧保留的置换表。每帧识别出的棋盘与上一帧通常只差几个格子，
+ * 新棋盘的大部分子状态（剩余目标格 + 剩余拼图块）在上一次求解中已经证明过，
+ * 重新求解主要是查表，整局游戏中决策延迟保持平稳。
+ *
+ * anytime 模式在后台线程中搜索，调用方只等待到截止时间，取得目前覆盖格数最多的放置；
+ * 截止时间之后搜索继续进行，下一帧的棋盘不变时直接得到改进后的结果（或完整解），
+ * 棋盘变化时取消旧搜索、开始新搜索，旧搜索已证明的子状态仍留在置换表中。
+ * solve/solveAnytime 只能在一个线程中调用；stats 可在任意线程读取。
+ */
+class SolverService {
+public:
+	/**
+	 * @param pieces 本局的全部拼图块
+	 * @param tableMegabytes 置换表内存上限
+	 */
+	explicit SolverService(const std::vector<PuzzlePiece>& pieces, size_t tableMegabytes = 16, bool allowReflection = true);
+	~SolverService();
+
+	SolverService(const SolverService&) = delete;
+	SolverService& operator=(const SolverService&) = delete;
+
+	bool solve(const std::vector<CellInfo>& cells, PuzzleSolution& outSolution);
+	bool solve(const Bitboard& board, PuzzleSolution& outSolution);
+	// 只使用 available 中列出的拼图块（已放下的拼图块不再参与），与完整集合共用置换表
+	bool solve(const std::vector<CellInfo>& cells, const std::vector<int>& available, PuzzleSolution& outSolution);
+
+	/**
+	 * @brief anytime 求解
+	 * 最多等待到 deadline，返回目前最好的结果；后台搜索在返回后继续。
+	 * @param available 可用的拼图块索引，nullptr 表示全部
+	 * @return 是否得到了放置（完整解或覆盖至少一格的部分放置）
+	 */
+	bool solveAnytime(const std::vector<CellInfo>& cells, std::chrono::steady_clock::time_point deadline, AnytimeSolution& outSolution,
+		const std::vector<int>* available = nullptr);
+	bool solveAnytime(const Bitboard& board, std::chrono::steady_clock::time_point deadline, AnytimeSolution& outSolution,
+		const std::vector<int>* available = nullptr);
+	// 取消后台搜索并等待其结束
+	void stopBackground();
+
+	// 丢弃置换表中的全部记录（例如换了一局、拼图块集合变化时应新建服务）
+	void clearTable();
+
+	PuzzleSolver& solver() { return m_solver; }
+	const TranspositionTable& table() const { return m_table; }
+	SolverServiceStats stats() const;
+
+private:
+	void record(bool found, double ms);
+	void recordSearch(uint64_t nodes, uint64_t probes, uint64_t hits, double seconds);
+	// 后台搜索开始，之后 stats 把其实时节点数与耗时计入统计，直到 recordSearch
+	void beginSearch();
+	void workerLoop();
+
+	TranspositionTable m_table;
+	PuzzleSolver m_solver;
+
+	mutable std::mutex m_statsMutex;
+	SolverServiceStats m_stats;
+	std::atomic<uint64_t> m_liveNodes{ 0 };            // 进行中的后台搜索已访问的节点数
+	bool m_searchRunning = false;                      // 以下两项由 m_statsMutex 保护
+	std::chrono::steady_clock::time_point m_searchStart;
+
+	// 后台搜索，以下成员（m_cancel 除外）由 m_jobMutex 保护
+	std::mutex m_jobMutex;
+	std::condition_variable m_wakeWorker;
+	std::condition_variable m_progress;    // 搜索结束或工作线程空闲
+	std::thread m_worker;
+	std::atomic<bool> m_cancel{ false };
+	bool m_stopping = false;
+	bool m_busy = false;
+	uint64_t m_jobId = 0;                  // 最新提交的任务
+	uint64_t m_runningId = 0;              // 工作线程已取走的任务
+	Bitboard m_jobBoard;
+	bool m_jobAllPieces = true;
+	std::vector<int> m_jobAvailable;
+	AnytimeSolution m_best;                // 最新任务目前的最好结果
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief 单生产者/单消费者无锁队列，容量为 1，新项覆盖未取走的旧项
+ *
+ * 三缓冲实现：生产者独占一个写缓冲，消费者独占一个读缓冲，第三个缓冲在两者之间交换，
+ * 交换只需一次原子 exchange，无需任何锁或 CAS 重试。
+ * 生产者写入时若上一项尚未被取走，直接用新项替换它，因此消费者取到的总是最新的一项，
+ * 过期项在生产端被丢弃，生产者永远不会因为队列满而阻塞或丢掉新项。
+ */
+template <typename T>
+class SpscQueue {
+public:
+	SpscQueue() = default;
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	/**
+	 * @brief 放入新项（仅生产者线程调用）
+	 * @return 是否覆盖了一个尚未被取走的旧项
+	 */
+	bool push(T&& value) {
+		m_slots[m_back] = std::move(value);
+		uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | kFresh), std::memory_order_acq_rel);
+		m_back = previous & kIndexMask;
+		return (previous & kFresh) != 0;
+	}
+
+	/**
+	 * @brief 取出最新的一项（仅消费者线程调用）
+	 * @return 自上次取出后没有新项时返回 false
+	 */
+	bool popLatest(T& out) {
+		if (!(m_middle.load(std::memory_order_relaxed) & kFresh)) {
+			return false;
+		}
+		uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_front), std::memory_order_acq_rel);
+		m_front = previous & kIndexMask;
+		out = std::move(m_slots[m_front]);
+		m_slots[m_front] = T();
+		return true;
+	}
+
+	bool empty() const {
+		return !(m_middle.load(std::memory_order_acquire) & kFresh);
+	}
+
+private:
+	static constexpr uint8_t kIndexMask = 3;
+	static constexpr uint8_t kFresh = 4;  // 中间缓冲中有尚未取走的新项
+
+	T m_slots[3];
+	alignas(64) std::atomic<uint8_t> m_middle{ 1 };
+	alignas(64) uint8_t m_back = 0;   // 生产者的写缓冲
+	alignas(64) uint8_t m_front = 2;  // 消费者的读缓冲
+};
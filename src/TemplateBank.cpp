@@ -0,0 +1,251 @@
+#include "TemplateBank.h"
+#include "Metrics.h"
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <cfloat>
+
+using namespace cv;
+using namespace std;
+
+// 与 matchTemplate 的 TM_CCOEFF_NORMED 归一化保持一致
+static inline double normalizeScore(double num, double t) {
+	if (fabs(num) < t) {
+		return num / t;
+	}
+	if (fabs(num) < t * 1.125) {
+		return num > 0 ? 1.0 : -1.0;
+	}
+	return 0.0;
+}
+
+// 由积分图计算每个窗口（多通道合计）的标准差 * sqrt(面积)
+static void windowStdDev(const Mat& sum, const Mat& sqsum, int cn, Size templSize, Mat& out) {
+	int rows = sum.rows - templSize.height;
+	int cols = sum.cols - templSize.width;
+	out.create(rows, cols, CV_32F);
+
+	double invArea = 1.0 / templSize.area();
+	for (int y = 0; y < rows; y++) {
+		const double* s0 = sum.ptr<double>(y);
+		const double* s1 = sum.ptr<double>(y + templSize.height);
+		const double* q0 = sqsum.ptr<double>(y);
+		const double* q1 = sqsum.ptr<double>(y + templSize.height);
+		float* o = out.ptr<float>(y);
+		for (int x = 0; x < cols; x++) {
+			double var = 0;
+			for (int k = 0; k < cn; k++) {
+				int a = x * cn + k;
+				int b = (x + templSize.width) * cn + k;
+				double s = s1[b] - s1[a] - s0[b] + s0[a];
+				double q = q1[b] - q1[a] - q0[b] + q0[a];
+				var += q - s * s * invArea;
+			}
+			o[x] = static_cast<float>(std::sqrt(std::max(var, 0.0)));
+		}
+	}
+}
+
+int TemplateBank::add(const string& name, const Mat& templateImage) {
+	if (templateImage.empty()) {
+		cerr << "Empty template: " << name << endl;
+		return -1;
+	}
+	if (m_type >= 0 && templateImage.type() != m_type) {
+		cerr << "Template type mismatch: " << name << endl;
+		return -1;
+	}
+	m_type = templateImage.type();
+
+	Entry entry;
+	entry.name = name;
+	entry.image = templateImage.clone();
+	entry.norm = 0;
+	m_templates.push_back(std::move(entry));
+
+	// 分块尺寸取最大模板的 4 倍左右，使 overlap-save 的重叠浪费较小
+	Size maxSize = m_templates.size() == 1 ? templateImage.size() : m_maxSize;
+	maxSize.width = std::max(maxSize.width, templateImage.cols);
+	maxSize.height = std::max(maxSize.height, templateImage.rows);
+	Size minSize = m_templates.size() == 1 ? templateImage.size() : m_minSize;
+	minSize.width = std::min(minSize.width, templateImage.cols);
+	minSize.height = std::min(minSize.height, templateImage.rows);
+	m_maxSize = maxSize;
+	m_minSize = minSize;
+
+	Size blockSize(getOptimalDFTSize(std::max(4 * maxSize.width, 64)),
+		getOptimalDFTSize(std::max(4 * maxSize.height, 64)));
+	if (blockSize != m_blockSize) {
+		m_blockSize = blockSize;
+		rebuildSpectra();
+	}
+	else {
+		computeSpectra(m_templates.back());
+	}
+
+	return static_cast<int>(m_templates.size()) - 1;
+}
+
+int TemplateBank::load(const string& name, const string& path) {
+	Mat image = imread(path);
+	if (image.empty()) {
+		cerr << "load template failed: " << path << endl;
+		return -1;
+	}
+	return add(name, image);
+}
+
+void TemplateBank::rebuildSpectra() {
+	for (auto& entry : m_templates) {
+		computeSpectra(entry);
+	}
+}
+
+void TemplateBank::computeSpectra(Entry& entry) const {
+	vector<Mat> planes;
+	split(entry.image, planes);
+
+	entry.spectra.assign(planes.size(), Mat());
+	double norm2 = 0;
+	Mat padded(m_blockSize, CV_32F);
+	for (size_t c = 0; c < planes.size(); c++) {
+		// 零均值模板：相关结果即为 CCOEFF 的分子
+		Mat plane;
+		planes[c].convertTo(plane, CV_32F, 1.0, -mean(planes[c])[0]);
+		double n = norm(plane, NORM_L2);
+		norm2 += n * n;
+
+		padded.setTo(Scalar::all(0));
+		plane.copyTo(padded(Rect(0, 0, plane.cols, plane.rows)));
+		dft(padded, entry.spectra[c]);
+	}
+	entry.norm = std::sqrt(norm2);
+}
+
+size_t TemplateBank::bytes() const {
+	size_t total = 0;
+	for (const auto& entry : m_templates) {
+		total += entry.image.total() * entry.image.elemSize();
+		for (const auto& spectrum : entry.spectra) {
+			total += spectrum.total() * spectrum.elemSize();
+		}
+	}
+	return total;
+}
+
+bool TemplateBank::matchAll(const Mat& image, vector<TemplateMatchResult>& outResults) const {
+	SNOW_SCOPED_TIMER("TemplateBank.matchAll");
+	outResults.clear();
+	if (image.empty() || m_templates.empty()) {
+		cerr << "Invalid image or empty template bank" << endl;
+		return false;
+	}
+	if (image.type() != m_type) {
+		cerr << "Image type does not match templates" << endl;
+		return false;
+	}
+	if (image.cols < m_maxSize.width || image.rows < m_maxSize.height) {
+		cerr << "Template larger than image" << endl;
+		return false;
+	}
+
+	int cn = image.channels();
+
+	// 整帧统计量只计算一次
+	Mat sum, sqsum;
+	cv::integral(image, sum, sqsum, CV_64F, CV_64F);
+
+	// 相同尺寸的模板共享窗口标准差图
+	map<pair<int, int>, Mat> stdMaps;
+	vector<const Mat*> stdOf(m_templates.size());
+	for (size_t i = 0; i < m_templates.size(); i++) {
+		Size s = m_templates[i].image.size();
+		Mat& stdMap = stdMaps[{ s.width, s.height }];
+		if (stdMap.empty()) {
+			windowStdDev(sum, sqsum, cn, s, stdMap);
+		}
+		stdOf[i] = &stdMap;
+	}
+
+	outResults.resize(m_templates.size());
+	vector<bool> constantTemplate(m_templates.size(), false);
+	for (size_t i = 0; i < m_templates.size(); i++) {
+		outResults[i].name = m_templates[i].name;
+		outResults[i].location = Point(0, 0);
+		outResults[i].score = -numeric_limits<double>::max();
+		// 常量模板与 matchTemplate 一致：整图得分均为 1
+		if (m_templates[i].norm < DBL_EPSILON) {
+			constantTemplate[i] = true;
+			outResults[i].score = 1.0;
+		}
+	}
+
+	vector<Mat> planes;
+	split(image, planes);
+	for (auto& plane : planes) {
+		plane.convertTo(plane, CV_32F);
+	}
+
+	int stepX = m_blockSize.width - m_maxSize.width + 1;
+	int stepY = m_blockSize.height - m_maxSize.height + 1;
+	vector<Mat> tileSpectra(cn);
+	Mat tile(m_blockSize, CV_32F);
+	Mat product, acc, corr;
+
+	for (int ty = 0; ty <= image.rows - m_minSize.height; ty += stepY) {
+		for (int tx = 0; tx <= image.cols - m_minSize.width; tx += stepX) {
+			// 分块频谱：所有模板共享
+			Rect src(tx, ty, std::min(m_blockSize.width, image.cols - tx), std::min(m_blockSize.height, image.rows - ty));
+			for (int c = 0; c < cn; c++) {
+				tile.setTo(Scalar::all(0));
+				planes[c](src).copyTo(tile(Rect(0, 0, src.width, src.height)));
+				dft(tile, tileSpectra[c]);
+			}
+
+			for (size_t i = 0; i < m_templates.size(); i++) {
+				if (constantTemplate[i]) {
+					continue;
+				}
+				const Entry& entry = m_templates[i];
+				int validW = std::min(stepX, image.cols - entry.image.cols + 1 - tx);
+				int validH = std::min(stepY, image.rows - entry.image.rows + 1 - ty);
+				if (validW <= 0 || validH <= 0) {
+					continue;
+				}
+
+				// 通道求和在频域完成，只需一次逆变换
+				for (int c = 0; c < cn; c++) {
+					mulSpectrums(tileSpectra[c], entry.spectra[c], c == 0 ? acc : product, 0, true);
+					if (c > 0) {
+						cv::add(acc, product, acc);
+					}
+				}
+				dft(acc, corr, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
+
+				TemplateMatchResult& best = outResults[i];
+				const Mat& stdMap = *stdOf[i];
+				for (int y = 0; y < validH; y++) {
+					const float* num = corr.ptr<float>(y);
+					const float* wnd = stdMap.ptr<float>(ty + y) + tx;
+					for (int x = 0; x < validW; x++) {
+						double score = normalizeScore(num[x], wnd[x] * entry.norm);
+						if (score > best.score) {
+							best.score = score;
+							best.location = Point(tx + x, ty + y);
+						}
+						else if (score == best.score) {
+							// 得分相同时取光栅顺序靠前的位置，与 minMaxLoc 一致
+							Point p(tx + x, ty + y);
+							if (p.y < best.location.y || (p.y == best.location.y && p.x < best.location.x)) {
+								best.location = p;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
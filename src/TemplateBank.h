@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 单个模板的匹配结果
+ */
+struct TemplateMatchResult {
+	std::string name;    // 模板名称
+	cv::Point location;  // 最佳匹配位置（左上角），与 TemplateMatch 返回值一致
+	double score;        // TM_CCOEFF_NORMED 得分
+};
+
+/**
+ * @brief 模板库
+ * 一次性加载所有模板，并对同一帧批量执行 TM_CCOEFF_NORMED 匹配
+ *
+ * 帧按固定尺寸分块做 DFT（overlap-save），每个分块的频谱只计算一次，
+ * 再与所有模板的预计算频谱相乘；窗口均值/方差由整帧积分图得到，
+ * 相同尺寸的模板共享同一张归一化分母图。
+ * 因此每个模板每个分块只需一次频谱乘法和一次逆变换。
+ */
+class TemplateBank {
+public:
+	/**
+	 * @brief 添加模板
+	 * @param name 模板名称
+	 * @param templateImage 模板图像，所有模板的类型必须一致
+	 * @return 模板索引，失败返回 -1
+	 */
+	int add(const std::string& name, const cv::Mat& templateImage);
+
+	/**
+	 * @brief 从文件加载模板
+	 * @return 模板索引，失败返回 -1
+	 */
+	int load(const std::string& name, const std::string& path);
+
+	size_t size() const { return m_templates.size(); }
+	bool empty() const { return m_templates.empty(); }
+	const std::string& name(size_t index) const { return m_templates[index].name; }
+	const cv::Mat& image(size_t index) const { return m_templates[index].image; }
+	// 模板图像与预计算频谱占用的字节数
+	size_t bytes() const;
+
+	/**
+	 * @brief 将所有模板与同一帧批量匹配
+	 * @param image 待匹配图像，类型需与模板一致
+	 * @param outResults 输出结果，顺序与模板添加顺序一致
+	 * @return 是否成功
+	 *
+	 * 不接受 FramePlanes：这里用到的彩色多通道积分图与逐通道浮点平面
+	 * 只服务于频域匹配，其他识别阶段都不使用，且每帧只在本函数内计算一次，放入 FramePlanes 没有可共享的部分。
+	 */
+	bool matchAll(const cv::Mat& image, std::vector<TemplateMatchResult>& outResults) const;
+
+private:
+	struct Entry {
+		std::string name;
+		cv::Mat image;
+		std::vector<cv::Mat> spectra; // 每通道零均值模板在分块尺寸下的频谱（CCS 格式）
+		double norm;                  // 零均值模板的 L2 范数
+	};
+
+	void rebuildSpectra();
+	void computeSpectra(Entry& entry) const;
+
+	std::vector<Entry> m_templates;
+	cv::Size m_maxSize;   // 最大模板尺寸
+	cv::Size m_minSize;   // 最小模板尺寸
+	cv::Size m_blockSize; // DFT 分块尺寸
+	int m_type = -1;
+};
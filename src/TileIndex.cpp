@@ -0,0 +1,179 @@
+#include "TileIndex.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+uint64_t TileHash(const Mat& image) {
+	if (image.empty()) {
+		return 0;
+	}
+	Mat gray, small;
+	if (image.channels() == 1) {
+		gray = image;
+	}
+	else {
+		cvtColor(image, gray, image.channels() == 4 ? COLOR_BGRA2GRAY : COLOR_BGR2GRAY);
+	}
+	resize(gray, small, Size(9, 8), 0, 0, INTER_AREA);
+
+	uint64_t hash = 0;
+	for (int y = 0; y < 8; y++) {
+		const uchar* p = small.ptr<uchar>(y);
+		for (int x = 0; x < 8; x++) {
+			hash = (hash << 1) | (p[x] < p[x + 1] ? 1u : 0u);
+		}
+	}
+	return hash;
+}
+
+int TileHashDistance(uint64_t a, uint64_t b) {
+	return popcount(a ^ b);
+}
+
+TileIndex::TileIndex(const TileIndexParams& params)
+	: m_params(params) {
+}
+
+int TileIndex::add(const string& name, const Mat& image) {
+	Tile tile;
+	tile.name = name;
+	tile.hash = TileHash(image);
+	if (image.empty() || !tile.hist.compute(image)) {
+		cerr << "failed to add tile: " << name << endl;
+		return -1;
+	}
+	int index = static_cast<int>(m_tiles.size());
+	m_tiles.push_back(std::move(tile));
+	insert(m_tiles.back().hash, index);
+	return index;
+}
+
+void TileIndex::insert(uint64_t hash, int tile) {
+	if (m_nodes.empty()) {
+		m_nodes.push_back({ hash, { tile }, {} });
+		return;
+	}
+	int current = 0;
+	while (true) {
+		int d = TileHashDistance(m_nodes[current].hash, hash);
+		if (d == 0) {
+			m_nodes[current].tiles.push_back(tile);
+			return;
+		}
+		int next = -1;
+		for (const auto& child : m_nodes[current].children) {
+			if (child.first == d) {
+				next = child.second;
+				break;
+			}
+		}
+		if (next < 0) {
+			m_nodes.push_back({ hash, { tile }, {} });
+			m_nodes[current].children.push_back({ d, static_cast<int>(m_nodes.size()) - 1 });
+			return;
+		}
+		current = next;
+	}
+}
+
+void TileIndex::query(uint64_t hash, int radius, vector<pair<int, int>>& outCandidates) const {
+	outCandidates.clear();
+	if (m_nodes.empty()) {
+		return;
+	}
+	// 三角不等式：只有到当前节点距离在 [d - radius, d + radius] 内的子树可能包含候选
+	vector<int> stack = { 0 };
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		int d = TileHashDistance(node.hash, hash);
+		if (d <= radius) {
+			for (int tile : node.tiles) {
+				outCandidates.push_back({ tile, d });
+			}
+		}
+		for (const auto& child : node.children) {
+			if (child.first >= d - radius && child.first <= d + radius) {
+				stack.push_back(child.second);
+			}
+		}
+	}
+	sort(outCandidates.begin(), outCandidates.end(), [](const pair<int, int>& a, const pair<int, int>& b) {
+		return a.second != b.second ? a.second < b.second : a.first < b.first;
+	});
+}
+
+TileMatch TileIndex::lookup(const Mat& crop) const {
+	return lookup(crop, crop);
+}
+
+TileMatch TileIndex::lookup(const Mat& crop, const Mat& grayCrop) const {
+	return lookup(crop, grayCrop, nullptr, Rect());
+}
+
+TileMatch TileIndex::lookup(const Mat& crop, const Mat& grayCrop, FramePlanes* planes, const Rect& roi) const {
+	SNOW_SCOPED_TIMER("TileIndex.lookup");
+	TileMatch match;
+	if (crop.empty() || m_tiles.empty()) {
+		return match;
+	}
+
+	vector<pair<int, int>> candidates;
+	query(TileHash(grayCrop), m_params.maxHamming, candidates);
+	if (candidates.empty()) {
+		return match;
+	}
+
+	// 最近候选足够近且明显领先：直接采用
+	int bestDistance = candidates.front().second;
+	bool unique = candidates.size() == 1 || candidates[1].second - bestDistance >= m_params.ambiguityMargin;
+	if (bestDistance <= m_params.confidentHamming && unique) {
+		match.index = candidates.front().first;
+		match.hamming = bestDistance;
+		return match;
+	}
+
+	// 有歧义：只对与最近候选距离相差不超过 ambiguityMargin 的候选做直方图复核
+	HsHistogram hist;
+	bool computed = planes && crop.channels() >= 3 ? hist.computeHsv(planes->hsv()(roi)) : hist.compute(crop);
+	if (!computed) {
+		return match;
+	}
+	double bestHist = m_params.maxHistDistance;
+	for (const auto& candidate : candidates) {
+		if (candidate.second - bestDistance >= m_params.ambiguityMargin) {
+			break;
+		}
+		double d = hist.bhattacharyya(m_tiles[candidate.first].hist);
+		if (d <= bestHist) {
+			bestHist = d;
+			match.index = candidate.first;
+			match.hamming = candidate.second;
+			match.histDistance = d;
+		}
+	}
+	return match;
+}
+
+void TileIndex::lookupCells(const Mat& fullImage, const vector<CellInfo>& cells, vector<TileMatch>& outMatches) const {
+	outMatches.resize(cells.size());
+	Rect frame(0, 0, fullImage.cols, fullImage.rows);
+	for (size_t i = 0; i < cells.size(); i++) {
+		Rect roi = cells[i].bounds & frame;
+		outMatches[i] = roi.empty() ? TileMatch() : lookup(fullImage(roi));
+	}
+}
+
+void TileIndex::lookupCells(FramePlanes& planes, const vector<CellInfo>& cells, vector<TileMatch>& outMatches) const {
+	const Mat& gray = planes.gray();
+	outMatches.resize(cells.size());
+	Rect frame(0, 0, gray.cols, gray.rows);
+	for (size_t i = 0; i < cells.size(); i++) {
+		Rect roi = cells[i].bounds & frame;
+		outMatches[i] = roi.empty() ? TileMatch() : lookup(planes.frame()(roi), gray(roi), &planes, roi);
+	}
+}
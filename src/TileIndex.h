@@ -0,0 +1,91 @@
+#pragma once
+
+#include "recognition.h"
+#include "HistogramEngine.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 64 位差值感知哈希（dHash）
+ * 灰度缩放到 9x8 后比较水平相邻像素的亮度，对缩放、噪声与整体亮度变化不敏感。
+ */
+uint64_t TileHash(const cv::Mat& image);
+
+// 两个哈希的汉明距离
+int TileHashDistance(uint64_t a, uint64_t b);
+
+// 图块查找参数
+struct TileIndexParams {
+	int maxHamming = 10;        // 候选的最大汉明距离
+	int confidentHamming = 4;   // 最近候选不超过该距离且领先足够多时直接采用
+	int ambiguityMargin = 3;    // 最近与次近候选的距离差小于该值视为有歧义
+	double maxHistDistance = 0.5; // 歧义时用 H-S 直方图复核，Bhattacharyya 距离上限
+};
+
+// 图块查找结果
+struct TileMatch {
+	int index = -1;            // 图块索引，未找到为 -1
+	int hamming = 64;          // 与该图块的汉明距离
+	double histDistance = -1;  // 经过直方图复核时的距离，否则为 -1
+};
+
+/**
+ * @brief 图块签名索引
+ *
+ * 每个已知图块保存 dHash 与 H-S 直方图，哈希组织成 BK 树（按汉明距离分支），
+ * 查找只访问与查询距离在 maxHamming 范围内可能存在候选的子树，代价随图块数量次线性增长。
+ * 只有候选有歧义时才对少数候选做直方图比较。
+ */
+class TileIndex {
+public:
+	explicit TileIndex(const TileIndexParams& params = TileIndexParams());
+
+	/**
+	 * @brief 添加图块
+	 * @return 图块索引，失败返回 -1
+	 */
+	int add(const std::string& name, const cv::Mat& image);
+
+	size_t size() const { return m_tiles.size(); }
+	bool empty() const { return m_tiles.empty(); }
+	const std::string& name(size_t index) const { return m_tiles[index].name; }
+	uint64_t hash(size_t index) const { return m_tiles[index].hash; }
+
+	// 识别一个裁剪区域
+	TileMatch lookup(const cv::Mat& crop) const;
+	// grayCrop 为 crop 的灰度图（例如取自 FramePlanes），感知哈希直接在其上计算
+	TileMatch lookup(const cv::Mat& crop, const cv::Mat& grayCrop) const;
+
+	// 识别每个单元格 bounds 内的图块，结果与 cells 顺序一致
+	void lookupCells(const cv::Mat& fullImage, const std::vector<CellInfo>& cells, std::vector<TileMatch>& outMatches) const;
+	// 整帧灰度图取自 planes；有歧义的单元格用 planes 的 HSV 平面复核，灰度与 HSV 每帧都只转换一次
+	void lookupCells(FramePlanes& planes, const std::vector<CellInfo>& cells, std::vector<TileMatch>& outMatches) const;
+
+	// 汉明距离在 radius 以内的全部图块（图块索引与距离），按距离升序
+	void query(uint64_t hash, int radius, std::vector<std::pair<int, int>>& outCandidates) const;
+
+private:
+	// planes 非空时直方图复核使用其中 HSV 平面的 roi 区域，否则由 crop 计算
+	TileMatch lookup(const cv::Mat& crop, const cv::Mat& grayCrop, FramePlanes* planes, const cv::Rect& roi) const;
+
+	struct Tile {
+		std::string name;
+		uint64_t hash;
+		HsHistogram hist;
+	};
+
+	// BK 树节点：哈希相同的图块共享节点，children 保存 (到本节点的距离, 子节点索引)
+	struct Node {
+		uint64_t hash;
+		std::vector<int> tiles;
+		std::vector<std::pair<int, int>> children;
+	};
+
+	void insert(uint64_t hash, int tile);
+
+	TileIndexParams m_params;
+	std::vector<Tile> m_tiles;
+	std::vector<Node> m_nodes;
+};
@@ -0,0 +1,616 @@
+#include "TraceLog.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+constexpr char kFileMagic[8] = { 'S', 'N', 'O', 'W', 'T', 'R', 'C', '1' };
+constexpr char kFooterMagic[8] = { 'S', 'N', 'O', 'W', 'I', 'D', 'X', '1' };
+constexpr uint32_t kVersion = 1;
+
+constexpr uint32_t fourcc(char a, char b, char c, char d) {
+	return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+constexpr uint32_t kFrameTag = fourcc('F', 'R', 'A', 'M');
+constexpr uint32_t kIndexTag = fourcc('I', 'N', 'D', 'X');
+
+enum : uint32_t {
+	kEncodingRaw = 0,
+	kEncodingDelta = 1
+};
+
+struct FileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct ChunkHeader {
+	uint32_t tag;
+	uint32_t reserved;
+	uint64_t size;       // 负载字节数，不含补齐
+};
+
+struct FrameRecord {
+	uint64_t frameIndex;
+	int64_t timestampNs;
+	int32_t width;
+	int32_t height;
+	int32_t type;
+	uint32_t encoding;
+	uint32_t gridFound;
+	uint32_t cellCount;
+	uint32_t timingCount;
+	uint32_t reserved;
+	uint64_t pixelBytes;
+};
+
+struct CellRecord {
+	int32_t id;
+	int32_t row;
+	int32_t col;
+	int32_t status;
+	float centerX;
+	float centerY;
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	float brightness;
+	float contrast;
+};
+
+struct TimingRecord {
+	char name[24];
+	uint64_t nanos;
+};
+
+struct Footer {
+	uint64_t indexOffset;
+	char magic[8];
+};
+
+// 记录都是 8 字节的整数倍，像素数据在文件中按 8 字节对齐
+static_assert(sizeof(FileHeader) == 16 && sizeof(ChunkHeader) == 16 && sizeof(Footer) == 16, "trace header layout");
+static_assert(sizeof(FrameRecord) == 56 && sizeof(CellRecord) == 48 && sizeof(TimingRecord) == 32, "trace record layout");
+
+uint64_t align8(uint64_t size) {
+	return (size + 7) & ~uint64_t(7);
+}
+
+void appendU32(vector<uchar>& out, uint32_t value) {
+	size_t at = out.size();
+	out.resize(at + sizeof(value));
+	memcpy(out.data() + at, &value, sizeof(value));
+}
+
+/**
+ * 差异编码：每段为 (距上一段末尾跳过的字节数, 长度, 新数据)
+ * 相距不足 mergeGap 的变化合并为一段；编码超过 limit 字节时放弃并返回 false
+ */
+bool encodeDelta(const uchar* prev, const uchar* cur, size_t n, size_t mergeGap, size_t limit, vector<uchar>& out) {
+	out.clear();
+	size_t last = 0;
+	size_t i = 0;
+	while (i < n) {
+		// 按 8 字节跳过相同区域
+		while (i + 8 <= n) {
+			uint64_t a, b;
+			memcpy(&a, prev + i, 8);
+			memcpy(&b, cur + i, 8);
+			if (a != b) {
+				break;
+			}
+			i += 8;
+		}
+		while (i < n && prev[i] == cur[i]) {
+			i++;
+		}
+		if (i >= n) {
+			break;
+		}
+
+		size_t start = i;
+		size_t end = i + 1;
+		for (size_t j = end; j < n && j - end < mergeGap; j++) {
+			if (prev[j] != cur[j]) {
+				end = j + 1;
+			}
+		}
+		appendU32(out, static_cast<uint32_t>(start - last));
+		appendU32(out, static_cast<uint32_t>(end - start));
+		out.insert(out.end(), cur + start, cur + end);
+		if (out.size() > limit) {
+			return false;
+		}
+		last = end;
+		i = end;
+	}
+	return true;
+}
+
+bool applyDelta(const uchar* data, uint64_t size, uchar* dst, size_t n) {
+	size_t pos = 0;
+	uint64_t p = 0;
+	while (p < size) {
+		uint32_t skip, length;
+		if (size - p < 8) {
+			return false;
+		}
+		memcpy(&skip, data + p, 4);
+		memcpy(&length, data + p + 4, 4);
+		p += 8;
+		if (skip > n - pos || length > n - pos - skip || length > size - p) {
+			return false;
+		}
+		pos += skip;
+		memcpy(dst + pos, data + p, length);
+		pos += length;
+		p += length;
+	}
+	return true;
+}
+
+const FrameRecord* frameRecord(const unsigned char* payload) {
+	return reinterpret_cast<const FrameRecord*>(payload);
+}
+
+const CellRecord* cellRecords(const unsigned char* payload) {
+	return reinterpret_cast<const CellRecord*>(payload + sizeof(FrameRecord));
+}
+
+const TimingRecord* timingRecords(const unsigned char* payload) {
+	return reinterpret_cast<const TimingRecord*>(payload + sizeof(FrameRecord) + frameRecord(payload)->cellCount * sizeof(CellRecord));
+}
+
+const unsigned char* pixelData(const unsigned char* payload) {
+	const FrameRecord* rec = frameRecord(payload);
+	return payload + sizeof(FrameRecord) + rec->cellCount * sizeof(CellRecord) + rec->timingCount * sizeof(TimingRecord);
+}
+
+size_t rawBytes(const FrameRecord* rec) {
+	return static_cast<size_t>(rec->width) * rec->height * CV_ELEM_SIZE(rec->type);
+}
+
+}
+
+TraceWriter::~TraceWriter() {
+	close();
+}
+
+bool TraceWriter::open(const string& path, const TraceWriterOptions& options) {
+	close();
+	m_file.open(path, ios::binary | ios::trunc);
+	if (!m_file) {
+		cerr << "failed to open trace file: " << path << endl;
+		return false;
+	}
+	m_options = options;
+	m_offsets.clear();
+	m_position = 0;
+	m_keyframes = 0;
+	m_sinceKeyframe = 0;
+	m_hasStart = false;
+	m_previous.release();
+
+	FileHeader header = {};
+	memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+	header.version = kVersion;
+	return write(&header, sizeof(header));
+}
+
+bool TraceWriter::close() {
+	if (!m_file.is_open()) {
+		return false;
+	}
+	uint64_t indexOffset = m_position;
+	ChunkHeader chunk = { kIndexTag, 0, m_offsets.size() * sizeof(uint64_t) };
+	Footer footer = {};
+	footer.indexOffset = indexOffset;
+	memcpy(footer.magic, kFooterMagic, sizeof(kFooterMagic));
+	bool ok = write(&chunk, sizeof(chunk)) && write(m_offsets.data(), chunk.size) && write(&footer, sizeof(footer));
+	m_file.close();
+	m_previous.release();
+	if (!ok) {
+		cerr << "failed to finish trace file" << endl;
+	}
+	return ok;
+}
+
+bool TraceWriter::write(const void* data, size_t size) {
+	if (size == 0) {
+		return true;
+	}
+	m_file.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+	m_position += size;
+	return static_cast<bool>(m_file);
+}
+
+bool TraceWriter::append(uint64_t frameIndex, chrono::steady_clock::time_point captureTime, const Mat& frame,
+	bool gridFound, const vector<CellInfo>& cells, const vector<StageTiming>& timings) {
+	SNOW_SCOPED_TIMER("TraceWriter.append");
+	if (!m_file.is_open()) {
+		return false;
+	}
+	if (!frame.empty() && frame.depth() != CV_8U) {
+		cerr << "trace only records 8-bit frames" << endl;
+		return false;
+	}
+	if (!m_hasStart) {
+		m_start = captureTime;
+		m_hasStart = true;
+	}
+
+	const Mat* cur = &frame;
+	if (!frame.empty() && !frame.isContinuous()) {
+		frame.copyTo(m_contiguous);
+		cur = &m_contiguous;
+	}
+	size_t frameBytes = cur->total() * cur->elemSize();
+
+	// 与上一帧尺寸类型相同且未到关键帧间隔时尝试差异编码
+	bool delta = false;
+	if (!cur->empty() && m_sinceKeyframe < m_options.keyframeInterval && !m_previous.empty()
+		&& m_previous.size() == cur->size() && m_previous.type() == cur->type()) {
+		size_t limit = static_cast<size_t>(frameBytes * m_options.maxDeltaRatio);
+		delta = encodeDelta(m_previous.data, cur->data, frameBytes, static_cast<size_t>(std::max(m_options.mergeGap, 0)), limit, m_delta);
+	}
+
+	FrameRecord rec = {};
+	rec.frameIndex = frameIndex;
+	rec.timestampNs = chrono::duration_cast<chrono::nanoseconds>(captureTime - m_start).count();
+	rec.width = cur->cols;
+	rec.height = cur->rows;
+	rec.type = cur->type();
+	rec.encoding = delta ? kEncodingDelta : kEncodingRaw;
+	rec.gridFound = gridFound ? 1 : 0;
+	rec.cellCount = static_cast<uint32_t>(cells.size());
+	rec.timingCount = static_cast<uint32_t>(timings.size());
+	rec.pixelBytes = delta ? m_delta.size() : frameBytes;
+
+	uint64_t payloadSize = sizeof(FrameRecord) + cells.size() * sizeof(CellRecord) + timings.size() * sizeof(TimingRecord) + rec.pixelBytes;
+	ChunkHeader chunk = { kFrameTag, 0, payloadSize };
+	uint64_t offset = m_position;
+	bool ok = write(&chunk, sizeof(chunk)) && write(&rec, sizeof(rec));
+
+	for (size_t i = 0; ok && i < cells.size(); i++) {
+		const CellInfo& c = cells[i];
+		CellRecord cell = { c.id, c.row, c.col, static_cast<int32_t>(c.status), c.center.x, c.center.y,
+			c.bounds.x, c.bounds.y, c.bounds.width, c.bounds.height, c.brightness, c.contrast };
+		ok = write(&cell, sizeof(cell));
+	}
+	for (size_t i = 0; ok && i < timings.size(); i++) {
+		TimingRecord timing = {};
+		if (timings[i].name) {
+			strncpy(timing.name, timings[i].name, sizeof(timing.name) - 1);
+		}
+		timing.nanos = timings[i].nanos;
+		ok = write(&timing, sizeof(timing));
+	}
+	if (ok) {
+		ok = delta ? write(m_delta.data(), m_delta.size()) : write(cur->data, frameBytes);
+	}
+	static const uint64_t padding = 0;
+	ok = ok && write(&padding, align8(payloadSize) - payloadSize);
+	if (!ok) {
+		cerr << "failed to write trace frame " << frameIndex << endl;
+		return false;
+	}
+
+	m_offsets.push_back(offset);
+	if (delta) {
+		m_sinceKeyframe++;
+	}
+	else {
+		m_sinceKeyframe = 0;
+		m_keyframes++;
+	}
+	if (cur->empty()) {
+		m_previous.release();
+	}
+	else {
+		cur->copyTo(m_previous);
+	}
+	return true;
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const string& path) {
+	close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		cerr << "failed to open file: " << path << endl;
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		cerr << "empty or unreadable file: " << path << endl;
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		cerr << "failed to map file: " << path << endl;
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close() {
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		CloseHandle(m_file);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const string& path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		cerr << "failed to open file: " << path << endl;
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		cerr << "empty or unreadable file: " << path << endl;
+		return false;
+	}
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED) {
+		::close(fd);
+		cerr << "failed to map file: " << path << endl;
+		return false;
+	}
+	// 回放基本是顺序读取
+	madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+	m_fd = fd;
+	m_data = static_cast<const unsigned char*>(view);
+	m_size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MappedFile::close() {
+	if (m_data) {
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+	}
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_fd = -1;
+}
+
+#endif
+
+bool TraceReader::open(const string& path) {
+	close();
+	if (!m_file.open(path)) {
+		return false;
+	}
+	const unsigned char* data = m_file.data();
+	size_t size = m_file.size();
+	if (size < sizeof(FileHeader) || memcmp(data, kFileMagic, sizeof(kFileMagic)) != 0
+		|| reinterpret_cast<const FileHeader*>(data)->version != kVersion) {
+		cerr << "not a trace file: " << path << endl;
+		m_file.close();
+		return false;
+	}
+
+	// 优先使用尾部索引
+	bool indexed = false;
+	if (size >= sizeof(FileHeader) + sizeof(ChunkHeader) + sizeof(Footer)) {
+		Footer footer;
+		memcpy(&footer, data + size - sizeof(Footer), sizeof(Footer));
+		if (memcmp(footer.magic, kFooterMagic, sizeof(kFooterMagic)) == 0
+			&& footer.indexOffset >= sizeof(FileHeader) && footer.indexOffset + sizeof(ChunkHeader) <= size - sizeof(Footer)) {
+			ChunkHeader chunk;
+			memcpy(&chunk, data + footer.indexOffset, sizeof(chunk));
+			uint64_t available = size - sizeof(Footer) - footer.indexOffset - sizeof(ChunkHeader);
+			if (chunk.tag == kIndexTag && chunk.size <= available && chunk.size % sizeof(uint64_t) == 0) {
+				indexed = true;
+				const unsigned char* p = data + footer.indexOffset + sizeof(ChunkHeader);
+				for (uint64_t i = 0; i < chunk.size / sizeof(uint64_t); i++) {
+					uint64_t offset;
+					memcpy(&offset, p + i * sizeof(uint64_t), sizeof(offset));
+					if (!addFrame(offset)) {
+						indexed = false;
+						m_frames.clear();
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// 没有索引（录制中断）或索引损坏：顺序扫描
+	if (!indexed) {
+		uint64_t pos = sizeof(FileHeader);
+		while (pos + sizeof(ChunkHeader) <= size) {
+			ChunkHeader chunk;
+			memcpy(&chunk, data + pos, sizeof(chunk));
+			if (chunk.size > size - pos - sizeof(ChunkHeader)) {
+				break;
+			}
+			if (chunk.tag == kFrameTag && !addFrame(pos)) {
+				break;
+			}
+			pos += sizeof(ChunkHeader) + align8(chunk.size);
+		}
+	}
+	return true;
+}
+
+bool TraceReader::addFrame(uint64_t chunkOffset) {
+	const unsigned char* data = m_file.data();
+	size_t size = m_file.size();
+	if (chunkOffset % 8 != 0 || chunkOffset + sizeof(ChunkHeader) + sizeof(FrameRecord) > size) {
+		return false;
+	}
+	ChunkHeader chunk;
+	memcpy(&chunk, data + chunkOffset, sizeof(chunk));
+	if (chunk.tag != kFrameTag || chunk.size < sizeof(FrameRecord) || chunk.size > size - chunkOffset - sizeof(ChunkHeader)) {
+		return false;
+	}
+	const FrameRecord* rec = frameRecord(data + chunkOffset + sizeof(ChunkHeader));
+	uint64_t expected = sizeof(FrameRecord) + uint64_t(rec->cellCount) * sizeof(CellRecord)
+		+ uint64_t(rec->timingCount) * sizeof(TimingRecord) + rec->pixelBytes;
+	if (expected != chunk.size || rec->width < 0 || rec->height < 0
+		|| (rec->encoding == kEncodingRaw && rec->pixelBytes != rawBytes(rec))
+		|| (rec->encoding != kEncodingRaw && rec->encoding != kEncodingDelta)) {
+		return false;
+	}
+	m_frames.push_back(chunkOffset + sizeof(ChunkHeader));
+	return true;
+}
+
+void TraceReader::close() {
+	m_frames.clear();
+	m_work.release();
+	m_workIndex = -1;
+	m_file.close();
+}
+
+bool TraceReader::frameInfo(size_t index, TraceFrameInfo& out) const {
+	if (index >= m_frames.size()) {
+		return false;
+	}
+	const FrameRecord* rec = frameRecord(payload(index));
+	out.frameIndex = rec->frameIndex;
+	out.timestampNs = rec->timestampNs;
+	out.width = rec->width;
+	out.height = rec->height;
+	out.type = rec->type;
+	out.keyframe = rec->encoding == kEncodingRaw;
+	out.gridFound = rec->gridFound != 0;
+	out.cellCount = rec->cellCount;
+	out.pixelBytes = rec->pixelBytes;
+	return true;
+}
+
+bool TraceReader::readCells(size_t index, vector<CellInfo>& outCells) const {
+	if (index >= m_frames.size()) {
+		return false;
+	}
+	const unsigned char* p = payload(index);
+	const CellRecord* records = cellRecords(p);
+	outCells.resize(frameRecord(p)->cellCount);
+	for (size_t i = 0; i < outCells.size(); i++) {
+		const CellRecord& r = records[i];
+		CellInfo& c = outCells[i];
+		c.id = r.id;
+		c.row = r.row;
+		c.col = r.col;
+		c.center = Point2f(r.centerX, r.centerY);
+		c.status = static_cast<CellInfo::Status>(r.status);
+		c.bounds = Rect(r.x, r.y, r.width, r.height);
+		c.brightness = r.brightness;
+		c.contrast = r.contrast;
+	}
+	return true;
+}
+
+bool TraceReader::readTimings(size_t index, vector<StageTiming>& outTimings) const {
+	if (index >= m_frames.size()) {
+		return false;
+	}
+	const unsigned char* p = payload(index);
+	const TimingRecord* records = timingRecords(p);
+	outTimings.resize(frameRecord(p)->timingCount);
+	for (size_t i = 0; i < outTimings.size(); i++) {
+		// 写入端保证名称以 0 结尾，损坏的记录不返回名称
+		const char* name = records[i].name;
+		outTimings[i].name = name[sizeof(records[i].name) - 1] == 0 ? name : "";
+		outTimings[i].nanos = records[i].nanos;
+	}
+	return true;
+}
+
+bool TraceReader::readFrame(size_t index, Mat& out) {
+	SNOW_SCOPED_TIMER("TraceReader.readFrame");
+	if (index >= m_frames.size()) {
+		return false;
+	}
+	const FrameRecord* rec = frameRecord(payload(index));
+	if (rec->width == 0 || rec->height == 0) {
+		out.release();
+		return true;
+	}
+	if (rec->encoding == kEncodingRaw) {
+		out = Mat(rec->height, rec->width, rec->type, const_cast<unsigned char*>(pixelData(payload(index))));
+		return true;
+	}
+
+	// 向前找到最近的原始帧；m_work 已经处于两者之间时从 m_work 继续
+	size_t key = index;
+	while (key > 0 && frameRecord(payload(key))->encoding != kEncodingRaw) {
+		key--;
+	}
+	const FrameRecord* keyRec = frameRecord(payload(key));
+	if (keyRec->encoding != kEncodingRaw) {
+		cerr << "trace frame " << index << " has no keyframe" << endl;
+		return false;
+	}
+	size_t start;
+	if (m_workIndex >= static_cast<int64_t>(key) && m_workIndex <= static_cast<int64_t>(index)) {
+		start = static_cast<size_t>(m_workIndex) + 1;
+	}
+	else {
+		Mat(keyRec->height, keyRec->width, keyRec->type, const_cast<unsigned char*>(pixelData(payload(key)))).copyTo(m_work);
+		m_workIndex = static_cast<int64_t>(key);
+		start = key + 1;
+	}
+
+	for (size_t i = start; i <= index; i++) {
+		const FrameRecord* r = frameRecord(payload(i));
+		if (r->width != m_work.cols || r->height != m_work.rows || r->type != m_work.type()
+			|| !applyDelta(pixelData(payload(i)), r->pixelBytes, m_work.data, m_work.total() * m_work.elemSize())) {
+			cerr << "corrupt trace frame " << i << endl;
+			m_workIndex = -1;
+			return false;
+		}
+		m_workIndex = static_cast<int64_t>(i);
+	}
+	out = m_work;
+	return true;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "recognition.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * 追踪日志（.snowtrace）：把每帧画面、识别结果与各阶段耗时追加到同一个二进制文件，用于离线回放
+ *
+ * 文件由 16 字节文件头和一系列分块组成，分块 = 16 字节分块头 + 负载（补齐到 8 字节）：
+ *   FRAM  一帧：帧记录、单元格结果、阶段耗时、像素数据
+ *   INDX  关闭时写入的全部 FRAM 分块偏移，文件最后 16 字节为 INDX 偏移与尾标记
+ * 像素数据是原始的连续行数据，或相对上一帧的差异段序列（跳过字节数、长度、新数据）；
+ * 每隔 keyframeInterval 帧强制写一个原始帧，限制随机访问时需要依次应用的差异帧数。
+ * 录制异常中断（没有 INDX）时，读取端顺序扫描分块重建索引，不完整的最后一块被丢弃。
+ * 所有字段使用本机字节序。
+ */
+
+// 一个阶段的耗时；name 不超过 23 个字符，超出部分写入时被截断
+struct StageTiming {
+	const char* name = "";
+	uint64_t nanos = 0;
+};
+
+// 录制参数
+struct TraceWriterOptions {
+	int keyframeInterval = 60;   // 最多连续写入的差异帧数
+	double maxDeltaRatio = 0.5;  // 差异编码超过原始大小的该比例时改写原始帧
+	int mergeGap = 16;           // 相距不足该字节数的变化段合并为一段，减少段头开销
+};
+
+// 读取端看到的帧信息
+struct TraceFrameInfo {
+	uint64_t frameIndex = 0;     // 录制时的帧序号
+	int64_t timestampNs = 0;     // 相对第一帧的捕获时间
+	int width = 0;
+	int height = 0;
+	int type = 0;
+	bool keyframe = false;       // 原始帧
+	bool gridFound = false;
+	size_t cellCount = 0;
+	uint64_t pixelBytes = 0;     // 像素数据在文件中占用的字节数
+};
+
+/**
+ * @brief 追踪日志写入器
+ * 同一时刻只能由一个线程调用。上一帧保存在内部缓冲区中，尺寸不变时不重新分配。
+ */
+class TraceWriter {
+public:
+	TraceWriter() = default;
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	bool open(const std::string& path, const TraceWriterOptions& options = TraceWriterOptions());
+	// 写入索引与尾标记并关闭文件
+	bool close();
+	bool isOpen() const { return m_file.is_open(); }
+
+	/**
+	 * @brief 追加一帧
+	 * @param frame 8 位图像（任意通道数），可以为空（只记录结果）
+	 * @return 是否写入成功
+	 */
+	bool append(uint64_t frameIndex, std::chrono::steady_clock::time_point captureTime, const cv::Mat& frame,
+		bool gridFound, const std::vector<CellInfo>& cells, const std::vector<StageTiming>& timings);
+
+	uint64_t frames() const { return m_offsets.size(); }
+	uint64_t keyframes() const { return m_keyframes; }
+	uint64_t bytesWritten() const { return m_position; }
+
+private:
+	bool write(const void* data, size_t size);
+
+	std::ofstream m_file;
+	TraceWriterOptions m_options;
+	std::vector<uint64_t> m_offsets;       // 每个 FRAM 分块头的文件偏移
+	uint64_t m_position = 0;
+	uint64_t m_keyframes = 0;
+	int m_sinceKeyframe = 0;
+	bool m_hasStart = false;
+	std::chrono::steady_clock::time_point m_start;
+	cv::Mat m_previous;                    // 上一帧（连续存储）
+	cv::Mat m_contiguous;                  // 非连续输入的拷贝
+	std::vector<unsigned char> m_delta;    // 差异编码缓冲区
+};
+
+/**
+ * @brief 只读内存映射文件
+ */
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	const unsigned char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
+
+/**
+ * @brief 追踪日志读取器
+ * 内存映射整个文件，按帧随机访问。原始帧直接返回映射内存上的只读视图；
+ * 差异帧从最近的原始帧（或上一次解码的帧）开始依次应用差异重建，顺序回放时每帧只应用一次差异。
+ */
+class TraceReader {
+public:
+	bool open(const std::string& path);
+	void close();
+
+	size_t frameCount() const { return m_frames.size(); }
+
+	bool frameInfo(size_t index, TraceFrameInfo& out) const;
+	bool readCells(size_t index, std::vector<CellInfo>& outCells) const;
+	// 阶段名称指向映射内存，在 close 之前有效
+	bool readTimings(size_t index, std::vector<StageTiming>& outTimings) const;
+
+	/**
+	 * @brief 解码一帧画面
+	 * @param out 在下一次 readFrame 或 close 之前有效，不能写入
+	 * @return 是否成功
+	 */
+	bool readFrame(size_t index, cv::Mat& out);
+
+private:
+	const unsigned char* payload(size_t index) const { return m_file.data() + m_frames[index]; }
+	bool addFrame(uint64_t chunkOffset);
+
+	MappedFile m_file;
+	std::vector<uint64_t> m_frames;  // 每帧 FRAM 负载的文件偏移
+	cv::Mat m_work;                  // 差异帧的重建缓冲区
+	int64_t m_workIndex = -1;        // m_work 当前对应的帧，-1 表示无效
+};
@@ -0,0 +1,98 @@
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+using namespace std;
+
+// data 字段布局：result 2 位 | move 16 位 | depth 8 位 | generation 8 位
+static constexpr int kMoveShift = 2;
+static constexpr int kDepthShift = 18;
+static constexpr int kGenerationShift = 26;
+
+static uint64_t packEntry(TranspositionTable::Result result, int move, int depth, uint32_t generation) {
+	return static_cast<uint64_t>(result)
+		| (static_cast<uint64_t>(move & 0xFFFF) << kMoveShift)
+		| (static_cast<uint64_t>(depth & 0xFF) << kDepthShift)
+		| (static_cast<uint64_t>(generation & 0xFF) << kGenerationShift);
+}
+
+static int entryDepth(uint64_t data) {
+	return static_cast<int>((data >> kDepthShift) & 0xFF);
+}
+
+static uint32_t entryGeneration(uint64_t data) {
+	return static_cast<uint32_t>((data >> kGenerationShift) & 0xFF);
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+	size_t buckets = std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Bucket), 1);
+	buckets = bit_floor(buckets);
+	m_buckets = make_unique<Bucket[]>(buckets);
+	m_mask = buckets - 1;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& outEntry) const {
+	const Bucket& bucket = m_buckets[key & m_mask];
+	for (const Slot& slot : bucket.slots) {
+		uint64_t data = slot.data.load(memory_order_relaxed);
+		if (data == 0 || (slot.check.load(memory_order_relaxed) ^ data) != key) {
+			continue;
+		}
+		outEntry.result = static_cast<Result>(data & 3);
+		outEntry.move = static_cast<int>((data >> kMoveShift) & 0xFFFF);
+		outEntry.depth = entryDepth(data);
+		return outEntry.result != UNKNOWN;
+	}
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, Result result, int move, int depth) {
+	Bucket& bucket = m_buckets[key & m_mask];
+	uint32_t generation = m_generation.load(memory_order_relaxed) & 0xFF;
+
+	// 同键或空项直接写入，否则淘汰价值最低的一项：旧代数优先，同代中剩余格数少的优先
+	Slot* victim = nullptr;
+	int victimScore = INT_MAX;
+	for (Slot& slot : bucket.slots) {
+		uint64_t data = slot.data.load(memory_order_relaxed);
+		if (data == 0 || (slot.check.load(memory_order_relaxed) ^ data) == key) {
+			victim = &slot;
+			break;
+		}
+		int age = static_cast<int>((generation - entryGeneration(data)) & 0xFF);
+		int score = entryDepth(data) - 4 * age;
+		if (score < victimScore) {
+			victimScore = score;
+			victim = &slot;
+		}
+	}
+
+	uint64_t data = packEntry(result, move, depth, generation);
+	victim->check.store(key ^ data, memory_order_relaxed);
+	victim->data.store(data, memory_order_relaxed);
+}
+
+void TranspositionTable::newGeneration() {
+	m_generation.fetch_add(1, memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+	for (size_t b = 0; b <= m_mask; b++) {
+		for (Slot& slot : m_buckets[b].slots) {
+			slot.check.store(0, memory_order_relaxed);
+			slot.data.store(0, memory_order_relaxed);
+		}
+	}
+}
+
+double TranspositionTable::occupancy() const {
+	size_t buckets = std::min<size_t>(m_mask + 1, 1024);
+	size_t used = 0;
+	for (size_t b = 0; b < buckets; b++) {
+		for (const Slot& slot : m_buckets[b].slots) {
+			used += slot.data.load(memory_order_relaxed) != 0;
+		}
+	}
+	return static_cast<double>(used) / static_cast<double>(buckets * kWays);
+}
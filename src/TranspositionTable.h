@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief 求解器置换表
+ *
+ * 以 Zobrist 哈希为键，记录搜索中已证明的子状态（剩余目标格 + 剩余拼图块）：
+ * 有解（附带第一步放置，可沿表逐步还原整条解）或无解。
+ * 子状态的结论与棋盘上其他格子无关，因此表可以跨帧、跨棋盘保留。
+ *
+ * 容量固定（每桶 4 项，占一条缓存行），写满后按“剩余格数少、代数旧”优先淘汰。
+ * 每项保存 key ^ data 与 data 两个原子字，读写都不加锁：
+ * 并发写入造成的撕裂项校验不通过，按未命中处理。可在多个线程间同时使用。
+ */
+class TranspositionTable {
+public:
+	enum Result : uint8_t {
+		UNKNOWN = 0,
+		SOLVED = 1,
+		UNSOLVABLE = 2
+	};
+
+	struct Entry {
+		Result result = UNKNOWN;
+		int move = 0;   // SOLVED 时为第一步在候选放置列表中的序号
+		int depth = 0;  // 子状态剩余目标格数
+	};
+
+	// megabytes: 表占用的内存上限，桶数向下取 2 的幂
+	explicit TranspositionTable(size_t megabytes = 16);
+
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+	bool probe(uint64_t key, Entry& outEntry) const;
+	void store(uint64_t key, Result result, int move, int depth);
+
+	// 开始新一轮求解（例如新的一帧），之后写入的项优先保留
+	void newGeneration();
+	void clear();
+
+	size_t capacity() const { return (m_mask + 1) * kWays; }
+	// 抽样估计的占用率（0~1）
+	double occupancy() const;
+
+private:
+	static constexpr int kWays = 4;
+
+	struct Slot {
+		std::atomic<uint64_t> check{ 0 }; // key ^ data
+		std::atomic<uint64_t> data{ 0 };
+	};
+	struct alignas(64) Bucket {
+		Slot slots[kWays];
+	};
+
+	std::unique_ptr<Bucket[]> m_buckets;
+	size_t m_mask = 0;
+	std::atomic<uint32_t> m_generation{ 0 };
+};
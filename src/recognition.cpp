@@ -1,6 +1,10 @@
 #include "recognition.h"
 #include "utils.h"
+#include "Metrics.h"
+#include "HistogramEngine.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 using namespace cv;
 using namespace std;
@@ -9,32 +13,55 @@ static void saveImages(const Mat& image, const string& filename) {
 	saveImage(image, filename, "grid");
 }
 
-Mat Image2Hist(const Mat& image) {
-	Mat imageHSV;
-	cvtColor(image, imageHSV, COLOR_BGR2HSV);
+// 仅用于调试输出的图像直接交给后台写入器，避免拷贝
+static void saveImages(Mat&& image, const string& filename) {
+	saveImage(std::move(image), filename, "grid");
+}
 
-	int histSize[] = { 50, 60 };
-	
-	float hRanges[] = { 0, 180 };
-	float sRanges[] = { 0, 256 };
-	const float* ranges[] = { hRanges, sRanges };
-	int channels[] = { 0, 1 };
+// H-S 直方图由 HsHistogram 一次遍历 BGR 像素得到，不再生成 HSV 中间图像
+Mat Image2Hist(const Mat& image) {
+	SNOW_SCOPED_TIMER("Image2Hist");
+	HsHistogram hist;
+	if (!hist.compute(image)) {
+		return Mat();
+	}
+	return hist.toMat();
+}
 
-	Mat hist;
-	calcHist(&image, 1, channels, Mat(), hist, 2, histSize, ranges);
-	normalize(hist, hist, 1.0, 0.0, NORM_L1);
+const Mat& Image2Hist(const Mat& image, RecognitionContext& context) {
+	SNOW_SCOPED_TIMER("Image2Hist");
+	if (!context.histogram.compute(image)) {
+		context.hist.release();
+		return context.hist;
+	}
+	context.histogram.toMat(context.hist);
+	return context.hist;
+}
 
-	return hist;
+const Mat& Image2Hist(FramePlanes& planes, const Rect& roi, RecognitionContext& context) {
+	SNOW_SCOPED_TIMER("Image2Hist");
+	Rect r = roi & Rect(0, 0, planes.frame().cols, planes.frame().rows);
+	// 整帧只转换一次 HSV，同一帧的其他区域直接分箱
+	bool ok = !r.empty() && planes.frame().channels() >= 3 && context.histogram.computeHsv(planes.hsv()(r));
+	if (!ok) {
+		context.hist.release();
+		return context.hist;
+	}
+	context.histogram.toMat(context.hist);
+	return context.hist;
 }
 
 double ImageHistCompare(const Mat& image, const Mat& hist) {
-	return compareHist(Image2Hist(image), hist, HISTCMP_BHATTACHARYYA);
+	SNOW_SCOPED_TIMER("ImageHistCompare");
+	HsHistogram query, templ;
+	if (!query.compute(image) || !templ.assign(hist)) {
+		return 1.0;
+	}
+	return query.bhattacharyya(templ);
 }
 
 Point TemplateMatch(const Mat& image, const Mat& templateImage) {
-	Mat imageHSV, templateHSV;
-	cvtColor(image, imageHSV, COLOR_BGR2HSV);
-    cvtColor(templateImage, templateHSV, COLOR_BGR2HSV);
+	SNOW_SCOPED_TIMER("TemplateMatch");
 	Mat result;
 	matchTemplate(image, templateImage, result, TM_CCOEFF_NORMED);
 	double min, max;
@@ -43,36 +70,193 @@ Point TemplateMatch(const Mat& image, const Mat& templateImage) {
 	return maxLoc;
 }
 
-bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells) {
-	if (fullImage.empty()) {
+Point TemplateMatch(const Mat& image, const Mat& templateImage, RecognitionContext& context) {
+	SNOW_SCOPED_TIMER("TemplateMatch");
+	matchTemplate(image, templateImage, context.matchResult, TM_CCOEFF_NORMED);
+	Point maxLoc;
+	minMaxLoc(context.matchResult, nullptr, nullptr, nullptr, &maxLoc);
+	return maxLoc;
+}
+
+// 在匹配结果图中选出前 count 个峰值，已选峰值附近一个模板大小的区域被抑制
+static vector<Point> pickCandidates(Mat& result, int count, Size templSize) {
+	vector<Point> candidates;
+	for (int i = 0; i < count; i++) {
+		double maxVal;
+		Point maxLoc;
+		minMaxLoc(result, nullptr, &maxVal, nullptr, &maxLoc);
+		if (maxVal == -numeric_limits<float>::max()) {
+			break;
+		}
+		candidates.push_back(maxLoc);
+
+		Rect suppress(maxLoc.x - templSize.width / 2, maxLoc.y - templSize.height / 2, templSize.width, templSize.height);
+		suppress &= Rect(0, 0, result.cols, result.rows);
+		result(suppress).setTo(Scalar::all(-numeric_limits<float>::max()));
+	}
+	return candidates;
+}
+
+Point TemplateMatch(const Mat& image, const Mat& templateImage, const PyramidMatchParams& params) {
+	FramePlanes planes(image);
+	return TemplateMatch(planes, templateImage, params);
+}
+
+Point TemplateMatch(FramePlanes& planes, const Mat& templateImage, const PyramidMatchParams& params) {
+	SNOW_SCOPED_TIMER("TemplateMatch.pyramid");
+	const Mat& image = planes.frame();
+	// 保证最顶层模板仍保留足够细节
+	int levels = std::max(0, params.levels);
+	while (levels > 0 && (std::min(templateImage.cols, templateImage.rows) >> levels) < params.minTemplateSize) {
+		levels--;
+	}
+	if (levels == 0) {
+		return TemplateMatch(image, templateImage);
+	}
+
+	// 图像金字塔由 planes 缓存，同一帧的其他模板直接复用
+	vector<Mat> templPyr(levels + 1);
+	templPyr[0] = templateImage;
+	for (int l = 1; l <= levels; l++) {
+		pyrDown(templPyr[l - 1], templPyr[l]);
+	}
+
+	// 顶层全图匹配，保留多个候选避免粗层误判
+	Mat result;
+	matchTemplate(planes.pyramid(levels), templPyr[levels], result, TM_CCOEFF_NORMED);
+	vector<Point> candidates = pickCandidates(result, std::max(1, params.candidates), templPyr[levels].size());
+
+	// 逐层细化：只在候选映射位置附近的小 ROI 中匹配
+	int radius = std::max(1, params.searchRadius);
+	Point best;
+	for (int l = levels - 1; l >= 0; l--) {
+		const Mat& img = planes.pyramid(l);
+		const Mat& templ = templPyr[l];
+		Rect resultBounds(0, 0, img.cols - templ.cols + 1, img.rows - templ.rows + 1);
+
+		vector<pair<double, Point>> refined;
+		for (const Point& c : candidates) {
+			Rect searchRect(c.x * 2 - radius, c.y * 2 - radius, 2 * radius + 1, 2 * radius + 1);
+			searchRect &= resultBounds;
+			if (searchRect.empty()) {
+				continue;
+			}
+			Rect roi(searchRect.x, searchRect.y, searchRect.width + templ.cols - 1, searchRect.height + templ.rows - 1);
+			matchTemplate(img(roi), templ, result, TM_CCOEFF_NORMED);
+
+			double maxVal;
+			Point maxLoc;
+			minMaxLoc(result, nullptr, &maxVal, nullptr, &maxLoc);
+			refined.push_back({ maxVal, maxLoc + roi.tl() });
+		}
+		if (refined.empty()) {
+			return TemplateMatch(image, templateImage);
+		}
+
+		stable_sort(refined.begin(), refined.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+		candidates.clear();
+		for (const auto& r : refined) {
+			if (find(candidates.begin(), candidates.end(), r.second) == candidates.end()) {
+				candidates.push_back(r.second);
+			}
+		}
+		best = candidates.front();
+	}
+
+	return best;
+}
+
+// 同尺寸矩形的 IoU
+static double overlapRatio(const Point& a, const Point& b, Size size) {
+	int w = size.width - abs(a.x - b.x);
+	int h = size.height - abs(a.y - b.y);
+	if (w <= 0 || h <= 0) {
+		return 0.0;
+	}
+	double inter = static_cast<double>(w) * h;
+	return inter / (2.0 * size.area() - inter);
+}
+
+// 从匹配结果图中提取局部极大值，再按得分贪心做非极大值抑制
+static vector<MatchCandidate> extractTopK(const Mat& result, Size templSize, const TopKMatchParams& params) {
+	Mat dilated;
+	dilate(result, dilated, Mat());
+
+	vector<MatchCandidate> peaks;
+	float threshold = static_cast<float>(params.threshold);
+	for (int y = 0; y < result.rows; y++) {
+		const float* r = result.ptr<float>(y);
+		const float* d = dilated.ptr<float>(y);
+		for (int x = 0; x < result.cols; x++) {
+			if (r[x] >= threshold && r[x] >= d[x]) {
+				peaks.push_back({ Point(x, y), r[x] });
+			}
+		}
+	}
+	sort(peaks.begin(), peaks.end(), [](const MatchCandidate& a, const MatchCandidate& b) { return a.score > b.score; });
+
+	vector<MatchCandidate> kept;
+	for (const auto& peak : peaks) {
+		if (static_cast<int>(kept.size()) >= params.topK) {
+			break;
+		}
+		bool suppressed = false;
+		for (const auto& k : kept) {
+			if (overlapRatio(peak.location, k.location, templSize) > params.nmsOverlap) {
+				suppressed = true;
+				break;
+			}
+		}
+		if (!suppressed) {
+			kept.push_back(peak);
+		}
+	}
+	return kept;
+}
+
+vector<vector<MatchCandidate>> TemplateMatchTopK(const Mat& image, const vector<Mat>& templates, const TopKMatchParams& params) {
+	SNOW_SCOPED_TIMER("TemplateMatchTopK");
+	vector<vector<MatchCandidate>> results(templates.size());
+	if (image.empty()) {
 		cerr << "Invalid image" << endl;
-		return false;
+		return results;
 	}
 
-	saveImages(fullImage, "01_original.jpg");
+	// 每个模板一个任务，由 OpenCV 并行后端（TBB）调度
+	parallel_for_(Range(0, static_cast<int>(templates.size())), [&](const Range& range) {
+		Mat result;
+		for (int i = range.start; i < range.end; i++) {
+			const Mat& templ = templates[i];
+			if (templ.empty() || templ.type() != image.type() || templ.cols > image.cols || templ.rows > image.rows) {
+				continue;
+			}
+			matchTemplate(image, templ, result, TM_CCOEFF_NORMED);
+			results[i] = extractTopK(result, templ.size(), params);
+		}
+	});
 
-	// 灰度转换
-	Mat gray, blurred;
-	cvtColor(fullImage, gray, COLOR_BGR2GRAY);
-	saveImages(gray, "02_gray.jpg");
+	return results;
+}
 
-	//GaussianBlur(gray, blurred, Size(5, 5), 0);
-	//saveImages(blurred, "03_blurred.jpg");
+RecognitionContext::RecognitionContext()
+	: kernel(getStructuringElement(MORPH_RECT, Size(3, 3))) {
+}
 
-	// 边缘检测
-	Mat edges;
-	Canny(gray, edges, 50, 150);
-	saveImages(edges, "04_edges.jpg");
+// 由边缘图定位网格区域：形态学闭运算 -> 最大外轮廓的包围矩形
+// 闭运算后的边缘图（context.morphed）留在 context 中，供分界线检测与跟踪校验复用
+static bool locateGridFromEdges(const Mat& fullImage, const Mat& edges, Rect& gridRect, RecognitionContext& context) {
+	Mat& morphed = context.morphed;
+	vector<vector<Point>>& contours = context.contours;
 
 	// 形态学操作连接断开的线条
-	Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
-	Mat morphed;
-	morphologyEx(edges, morphed, MORPH_CLOSE, kernel);
+	SNOW_STAGE_BEGIN(stage, "analyzeGrid.morphology");
+	morphologyEx(edges, morphed, MORPH_CLOSE, context.kernel);
 	saveImages(morphed, "05_morphed.jpg");
 	
 	// 寻找网格区域（最大的矩形轮廓）
-	vector<vector<Point>> contours;
+	SNOW_STAGE_NEXT(stage, "analyzeGrid.findContours");
 	findContours(morphed, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+	SNOW_STAGE_END(stage);
 
 	// 绘制检测到的所有轮廓
 	if (g_debug) {
@@ -94,76 +278,292 @@ bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells) {
 			putText(contoursAllVis, to_string(i), c + Point2f(1, 1), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 0, 0), 2);
 			putText(contoursAllVis, to_string(i), c, FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255, 255, 255), 1);
 		}
-		saveImages(contoursAllVis, "06_contours_all.jpg");
+		saveImages(std::move(contoursAllVis), "06_contours_all.jpg");
 	}
 
-	// 找到最大的矩形轮廓
+	// 找到最大的矩形轮廓（只记录下标，不拷贝轮廓）
+	SNOW_STAGE_NEXT(stage, "analyzeGrid.contourArea");
 	double maxArea = 0;
-	vector<Point> gridContour;
-	for (const auto& contour : contours) {
-		double area = contourArea(contour);
+	int gridContour = -1;
+	for (size_t i = 0; i < contours.size(); i++) {
+		double area = contourArea(contours[i]);
 		if (area > maxArea) {
 			maxArea = area;
-			gridContour = contour;
+			gridContour = static_cast<int>(i);
 		}
 	}
+	SNOW_STAGE_END(stage);
 
-	if (gridContour.empty()) {
+	if (gridContour < 0) {
 		cerr << "No grid found" << endl;
 		return false;
 	}
 
-	if (!g_debug) {
+	if (g_debug) {
 		Mat gridContourVis = fullImage.clone();
-		vector<vector<Point>> gridOnly; gridOnly.push_back(gridContour);
-		drawContours(gridContourVis, gridOnly, -1, Scalar(0, 0, 255), 3);
-		saveImages(gridContourVis, "06_grid_contour.jpg");
+		drawContours(gridContourVis, contours, gridContour, Scalar(0, 0, 255), 3);
+		saveImages(std::move(gridContourVis), "06_grid_contour.jpg");
 	}
 
 	// 获取网格边界矩形
-	Rect gridRect = boundingRect(gridContour);
+	gridRect = boundingRect(contours[gridContour]);
 
 	if (g_debug) {
 		Mat bboxVis = fullImage.clone();
 		rectangle(bboxVis, gridRect, Scalar(255, 0, 0), 2);
-		saveImages(bboxVis, "07_grid_bbox.jpg");
+		saveImages(std::move(bboxVis), "07_grid_bbox.jpg");
 	}
 
+	return true;
+}
+
+// 定位网格区域：灰度 -> 边缘 -> locateGridFromEdges
+// 灰度图（context.gray）与边缘图（context.edges）留在 context 中，供单元格分类复用
+static bool locateGrid(const Mat& fullImage, Rect& gridRect, RecognitionContext& context) {
+	// 灰度转换
+	SNOW_STAGE_BEGIN(stage, "analyzeGrid.gray");
+	cvtColor(fullImage, context.gray, COLOR_BGR2GRAY);
+	saveImages(context.gray, "02_gray.jpg");
+
+	//GaussianBlur(gray, blurred, Size(5, 5), 0);
+	//saveImages(blurred, "03_blurred.jpg");
+
+	// 边缘检测，阈值与 FramePlanes::edges 一致
+	SNOW_STAGE_NEXT(stage, "analyzeGrid.canny");
+	Canny(context.gray, context.edges, FramePlanes::kCannyLow, FramePlanes::kCannyHigh);
+	saveImages(context.edges, "04_edges.jpg");
+	SNOW_STAGE_END(stage);
+
+	return locateGridFromEdges(fullImage, context.edges, gridRect, context);
+}
+
+// 灰度图与边缘图取自 planes，每帧只计算一次
+static bool locateGrid(FramePlanes& planes, Rect& gridRect, RecognitionContext& context) {
+	saveImages(planes.gray(), "02_gray.jpg");
+	saveImages(planes.edges(), "04_edges.jpg");
+	return locateGridFromEdges(planes.frame(), planes.edges(), gridRect, context);
+}
+
+// 按灰度均值判断单元格状态
+static CellInfo::Status statusFromBrightness(double brightness, const GridLayout& layout) {
+	return brightness > layout.blockedBrightness ? CellInfo::Status::BLOCKED : CellInfo::Status::AVAILABLE;
+}
+
+// 单独分类一个单元格（增量分析时使用），gray 作为可复用的缓冲区
+static void classifyCell(const Mat& cellRegion, Mat& gray, const GridLayout& layout, CellInfo& cell) {
+	Scalar mean, stddev;
+	if (cellRegion.channels() == 1) {
+		meanStdDev(cellRegion, mean, stddev);
+	}
+	else {
+		cvtColor(cellRegion, gray, COLOR_BGR2GRAY);
+		meanStdDev(gray, mean, stddev);
+	}
+	cell.brightness = static_cast<float>(mean[0]);
+	cell.contrast = static_cast<float>(stddev[0]);
+	cell.status = statusFromBrightness(mean[0], layout);
+}
+
+// 优先使用 planes 中已有的积分图（O(1)）或整帧灰度图，都没有时只转换单元格区域
+static void classifyCell(FramePlanes& planes, const Rect& bounds, Mat& gray, const GridLayout& layout, CellInfo& cell) {
+	if (!planes.has(FramePlanes::INTEGRAL)) {
+		classifyCell(planes.has(FramePlanes::GRAY) ? planes.gray()(bounds) : planes.frame()(bounds), gray, layout, cell);
+		return;
+	}
+	double mean, stddev;
+	planes.meanStdDev(bounds, mean, stddev);
+	cell.brightness = static_cast<float>(mean);
+	cell.contrast = static_cast<float>(stddev);
+	cell.status = statusFromBrightness(mean, layout);
+}
+
+// 原地写入等分几何，复用 geometry 中向量的容量
+static void assignUniform(GridGeometry& geometry, const Rect& bounds, int rows, int cols) {
+	geometry.bounds = bounds;
+	geometry.rowLines.clear();
+	geometry.colLines.clear();
+	if (rows <= 0 || cols <= 0) {
+		return;
+	}
+	int cellWidth = bounds.width / cols;
+	int cellHeight = bounds.height / rows;
+	for (int i = 0; i <= rows; i++) {
+		geometry.rowLines.push_back(bounds.y + i * cellHeight);
+	}
+	for (int i = 0; i <= cols; i++) {
+		geometry.colLines.push_back(bounds.x + i * cellWidth);
+	}
+}
+
+GridGeometry GridGeometry::uniform(const Rect& bounds, int rows, int cols) {
+	GridGeometry geometry;
+	assignUniform(geometry, bounds, rows, cols);
+	return geometry;
+}
+
+// 在投影曲线中寻找分界线：超过阈值的连续段取中点，间距小于 minGap 的相邻线（粗线、间隙两侧的边线）合并为一条
+// 两端距离边缘不足 minGap 的线吸附到边缘，保证结果包含外边框
+static void findLines(const Mat& profile, float threshold, int minGap, vector<int>& peaks, vector<int>& lines) {
+	const float* p = profile.ptr<float>();
+	int length = static_cast<int>(profile.total());
+
+	peaks.clear();
+	for (int i = 0; i < length;) {
+		if (p[i] < threshold) {
+			i++;
+			continue;
+		}
+		int begin = i;
+		while (i < length && p[i] >= threshold) {
+			i++;
+		}
+		peaks.push_back((begin + i - 1) / 2);
+	}
+
+	lines.clear();
+	size_t groupBegin = 0;
+	for (size_t i = 1; i <= peaks.size(); i++) {
+		if (i < peaks.size() && peaks[i] - peaks[i - 1] < minGap) {
+			continue;
+		}
+		lines.push_back((peaks[groupBegin] + peaks[i - 1]) / 2);
+		groupBegin = i;
+	}
+
+	if (lines.empty() || lines.front() >= minGap) {
+		lines.insert(lines.begin(), 0);
+	}
+	else {
+		lines.front() = 0;
+	}
+	if (lines.back() <= length - 1 - minGap) {
+		lines.push_back(length);
+	}
+	else {
+		lines.back() = length;
+	}
+}
+
+// 分界线间距需大致均匀：每个间距都在中位数的一半到 1.5 倍之间
+static bool regularSpacing(const vector<int>& lines, vector<int>& gaps) {
+	if (lines.size() < 2) {
+		return false;
+	}
+	gaps.clear();
+	for (size_t i = 1; i < lines.size(); i++) {
+		gaps.push_back(lines[i] - lines[i - 1]);
+	}
+	// 只检查每个间距与中位数的关系，与顺序无关，可以直接在 gaps 上求中位数
+	nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+	int median = gaps[gaps.size() / 2];
+	for (int gap : gaps) {
+		if (gap * 2 < median || gap * 2 > median * 3) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool detectLines(const Mat& edges, const Rect& gridRect, GridGeometry& outGeometry, RecognitionContext& context) {
+	SNOW_SCOPED_TIMER("detectGridGeometry");
+	Rect roi = gridRect & Rect(0, 0, edges.cols, edges.rows);
+	if (roi.width < 8 || roi.height < 8) {
+		return false;
+	}
+	Mat region = edges(roi);
+
+	// 列投影（每列的边缘像素数）与行投影，归一化为覆盖比例
+	Mat& colProfile = context.colProfile;
+	Mat& rowProfile = context.rowProfile;
+	reduce(region, colProfile, 0, REDUCE_SUM, CV_32F);
+	reduce(region, rowProfile, 1, REDUCE_SUM, CV_32F);
+	colProfile.convertTo(colProfile, CV_32F, 1.0 / (255.0 * roi.height));
+	rowProfile.convertTo(rowProfile, CV_32F, 1.0 / (255.0 * roi.width));
+
+	// 网格线至少贯穿一半长度；单元格边长不小于网格的 1/16，合并距离取其一半
+	const float coverage = 0.5f;
+	vector<int>& cols = context.colLines;
+	vector<int>& rows = context.rowLines;
+	findLines(colProfile, coverage, std::max(3, roi.width / 32), context.peaks, cols);
+	findLines(rowProfile, coverage, std::max(3, roi.height / 32), context.peaks, rows);
+	// 至少 2x2、至多 16x16 个单元格
+	if (cols.size() < 3 || rows.size() < 3 || cols.size() > 17 || rows.size() > 17 || !regularSpacing(cols, context.gaps) || !regularSpacing(rows, context.gaps)) {
+		return false;
+	}
+
+	outGeometry.bounds = roi;
+	outGeometry.colLines.clear();
+	outGeometry.rowLines.clear();
+	for (int x : cols) {
+		outGeometry.colLines.push_back(roi.x + x);
+	}
+	for (int y : rows) {
+		outGeometry.rowLines.push_back(roi.y + y);
+	}
+	return true;
+}
+
+bool detectGridGeometry(const Mat& edges, const Rect& gridRect, GridGeometry& outGeometry) {
+	RecognitionContext context;
+	return detectLines(edges, gridRect, outGeometry, context);
+}
+
+// 积分图中 [x0, x1) x [y0, y1) 的和，网格区域的积分图为 CV_32S，FramePlanes 的整帧积分图为 CV_64F
+static double rectSum(const Mat& sum, int x0, int y0, int x1, int y1) {
+	if (sum.depth() == CV_32S) {
+		return static_cast<double>(sum.at<int>(y1, x1) - sum.at<int>(y1, x0) - sum.at<int>(y0, x1) + sum.at<int>(y0, x0));
+	}
+	return sum.at<double>(y1, x1) - sum.at<double>(y1, x0) - sum.at<double>(y0, x1) + sum.at<double>(y0, x0);
+}
+
+// 按网格几何识别每个单元格的状态
+// 积分图与平方积分图的 (0, 0) 对应 fullImage 中的 origin，每个单元格的均值和方差只需 8 次查表
+static bool classifyCells(const Mat& fullImage, const GridGeometry& geometry, const GridLayout& layout, const Mat& sum, const Mat& sqsum, Point origin, vector<CellInfo>& outCells) {
+	SNOW_SCOPED_TIMER("analyzeGrid.cells");
+	const Rect& gridRect = geometry.bounds;
 	Mat gridImage = fullImage(gridRect);
 	saveImages(gridImage, "07_grid_region.jpg");
 
-	// 计算单元格尺寸
-	int cellWidth = gridImage.cols / 6;  // 6列
-	int cellHeight = gridImage.rows / 5; // 5行
+	int rows = geometry.rows();
+	int cols = geometry.cols();
+	if (rows <= 0 || cols <= 0) {
+		cerr << "Invalid grid layout: " << rows << "x" << cols << endl;
+		return false;
+	}
+
+	// 网格坐标到积分图坐标的偏移
+	int ox = gridRect.x - origin.x;
+	int oy = gridRect.y - origin.y;
 
 	// 分割单元格并识别状态
-	Mat cellAnalysisImage = gridImage.clone();
-	for (int row = 0; row < 5; row++) {
-		for (int col = 0; col < 6; col++) {
-			int cellId = row * 6 + col + 1;
+	Mat cellAnalysisImage;
+	if (g_debug) {
+		cellAnalysisImage = gridImage.clone();
+	}
+	outCells.reserve(outCells.size() + static_cast<size_t>(rows) * cols);
+	for (int row = 0; row < rows; row++) {
+		int y = geometry.rowLines[row] - gridRect.y;
+		int y1 = geometry.rowLines[row + 1] - gridRect.y;
+		for (int col = 0; col < cols; col++) {
+			int cellId = row * cols + col + 1;
 
-			int x = col * cellWidth;
-			int y = row * cellHeight;
+			int x = geometry.colLines[col] - gridRect.x;
+			int x1 = geometry.colLines[col + 1] - gridRect.x;
+			int cellWidth = x1 - x;
+			int cellHeight = y1 - y;
+			if (cellWidth <= 0 || cellHeight <= 0) {
+				cerr << "Grid too small for layout: " << gridRect.width << "x" << gridRect.height << endl;
+				return false;
+			}
 			Rect cellRect(x, y, cellWidth, cellHeight);
-			Mat cellRegion = gridImage(cellRect);
+
+			double area = static_cast<double>(cellWidth) * cellHeight;
+			double mean = rectSum(sum, x + ox, y + oy, x1 + ox, y1 + oy) / area;
+			double variance = rectSum(sqsum, x + ox, y + oy, x1 + ox, y1 + oy) / area - mean * mean;
 
 			Point2f center(static_cast<float>(x + cellWidth / 2.0f), static_cast<float>(y + cellHeight / 2.0f));
 
-			Mat cellGray;
-			cvtColor(cellRegion, cellGray, COLOR_BGR2GRAY);
-			Scalar meanBrightness = mean(cellGray);
-			double brightness = meanBrightness[0];
-
-			CellInfo::Status status;
-			Scalar color;
-			if (brightness > 200) {
-				status = CellInfo::Status::BLOCKED;
-				color = Scalar(0, 0, 255);
-			}
-			else {
-				status = CellInfo::Status::AVAILABLE;
-				color = Scalar(0, 255, 0);
-			}
+			CellInfo::Status status = statusFromBrightness(mean, layout);
 
 			CellInfo cell;
 			cell.id = cellId;
@@ -172,35 +572,456 @@ bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells) {
 			cell.center = Point2f(static_cast<float>(gridRect.x) + center.x, static_cast<float>(gridRect.y) + center.y);
 			cell.status = status;
 			cell.bounds = Rect(gridRect.x + x, gridRect.y + y, cellWidth, cellHeight);
+			cell.brightness = static_cast<float>(mean);
+			cell.contrast = static_cast<float>(sqrt(std::max(variance, 0.0)));
 			outCells.push_back(cell);
 			
 			if (g_debug) {
+				Scalar color = status == CellInfo::Status::BLOCKED ? Scalar(0, 0, 255) : Scalar(0, 255, 0);
 				rectangle(cellAnalysisImage, cellRect, color, 2);
 				putText(cellAnalysisImage, to_string(cellId), Point(x + 5, y + 20), FONT_HERSHEY_SIMPLEX, 0.5, color, 1);
 				putText(cellAnalysisImage, status == CellInfo::Status::BLOCKED ? "blocked" : "avaliable", Point(x + 5, y + cellHeight - 5), FONT_HERSHEY_SIMPLEX, 0.4, color, 1);
-				saveImages(cellRegion, string("08_cell_") + to_string(cellId) + ".jpg");
+				saveImages(gridImage(cellRect), string("08_cell_") + to_string(cellId) + ".jpg");
 			}
 		}
 	}
 
-	saveImages(cellAnalysisImage, "8_cell_analysis.jpg");
+	saveImages(std::move(cellAnalysisImage), "8_cell_analysis.jpg");
+	return true;
+}
+
+// 原图可视化
+static void saveFinalResult(const Mat& fullImage, const vector<CellInfo>& cells) {
+	if (!g_debug) {
+		return;
+	}
+	Mat outFinalResult = fullImage.clone();
+	for (const auto& cell : cells) {
+		Scalar color = (cell.status == CellInfo::Status::BLOCKED) ? Scalar(0, 0, 255) : Scalar(0, 255, 0);
+		Rect absoluteBounds = cell.bounds;
+		Point2f absoluteCenter = cell.center;
+		rectangle(outFinalResult, absoluteBounds, color, 2);
+		putText(outFinalResult, to_string(cell.id), Point(absoluteBounds.x + 5, absoluteBounds.y + 20), FONT_HERSHEY_SIMPLEX, 0.6, color, 2);
+		circle(outFinalResult, absoluteCenter, 3, color, -1);
+		circle(outFinalResult, absoluteCenter, 5, Scalar(255, 255, 255), 1);
+	}
+	saveImages(std::move(outFinalResult), "9_final_result.jpg");
+}
+
+bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells) {
+	return analyzeGrid(fullImage, outCells, GridLayout());
+}
 
-	// 原图可视化
+// 在已定位的网格上检测分界线并分类单元格，image 可以是整帧或其中的 ROI，结果坐标相对 image
+// gray 为 image 的灰度图；依赖 locateGrid 留在 context 中的闭运算边缘图，几何写入 context.geometry
+// planes 非空且已有整帧积分图时直接使用（offset 为 image 在帧中的位置），否则只对网格区域求积分图
+static bool analyzeLocatedGrid(const Mat& image, const Mat& gray, const Rect& gridRect, const GridLayout& layout, vector<CellInfo>& outCells, RecognitionContext& context,
+	FramePlanes* planes = nullptr, Point offset = Point()) {
+	GridGeometry& geometry = context.geometry;
+	// 优先使用检测到的分界线，失败时按 layout 等分
+	if (!layout.detectLines || !detectLines(context.morphed, gridRect, geometry, context)) {
+		assignUniform(geometry, gridRect, layout.rows, layout.cols);
+	}
 	if (g_debug) {
-		Mat outFinalResult = fullImage.clone();
-		for (const auto& cell : outCells) {
-			Scalar color = (cell.status == CellInfo::Status::BLOCKED) ? Scalar(0, 0, 255) : Scalar(0, 255, 0);
-			Rect absoluteBounds = cell.bounds;
-			Point2f absoluteCenter = cell.center;
-			rectangle(outFinalResult, absoluteBounds, color, 2);
-			putText(outFinalResult, to_string(cell.id), Point(absoluteBounds.x + 5, absoluteBounds.y + 20), FONT_HERSHEY_SIMPLEX, 0.6, color, 2);
-			circle(outFinalResult, absoluteCenter, 3, color, -1);
-			circle(outFinalResult, absoluteCenter, 5, Scalar(255, 255, 255), 1);
+		Mat linesVis = image.clone();
+		for (int x : geometry.colLines) {
+			line(linesVis, Point(x, geometry.bounds.y), Point(x, geometry.bounds.br().y), Scalar(0, 255, 255), 2);
+		}
+		for (int y : geometry.rowLines) {
+			line(linesVis, Point(geometry.bounds.x, y), Point(geometry.bounds.br().x, y), Scalar(0, 255, 255), 2);
+		}
+		saveImages(std::move(linesVis), "07_grid_lines.jpg");
+	}
+
+	if (planes && planes->has(FramePlanes::INTEGRAL)) {
+		return classifyCells(image, geometry, layout, planes->integralSum(), planes->integralSqSum(), Point(-offset.x, -offset.y), outCells);
+	}
+	cv::integral(gray(geometry.bounds), context.integralSum, context.integralSqSum, CV_32S, CV_64F);
+	return classifyCells(image, geometry, layout, context.integralSum, context.integralSqSum, geometry.bounds.tl(), outCells);
+}
+
+bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells, const GridLayout& layout, GridGeometry* outGeometry) {
+	RecognitionContext context;
+	return analyzeGrid(fullImage, outCells, layout, context, outGeometry);
+}
+
+bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells, RecognitionContext& context) {
+	return analyzeGrid(fullImage, outCells, GridLayout(), context);
+}
+
+bool analyzeGrid(const Mat& fullImage, vector<CellInfo>& outCells, const GridLayout& layout, RecognitionContext& context, GridGeometry* outGeometry) {
+	context.planes.reset(fullImage);
+	bool ok = analyzeGrid(context.planes, outCells, layout, context, outGeometry);
+	context.planes.clear();
+	return ok;
+}
+
+// 整帧分析，不推进调试采样的帧计数，供已经计过数的入口（如 GridTracker 的回退）调用
+static bool analyzeFrame(FramePlanes& planes, vector<CellInfo>& outCells, const GridLayout& layout, RecognitionContext& context, GridGeometry* outGeometry) {
+	SNOW_SCOPED_TIMER("analyzeGrid");
+	const Mat& fullImage = planes.frame();
+	if (fullImage.empty()) {
+		cerr << "Invalid image" << endl;
+		return false;
+	}
+
+	// 原图不拷贝，与调用方共享缓冲区
+	saveImageShared(fullImage, "01_original.jpg", "grid");
+
+	Rect gridRect;
+	if (!locateGrid(planes, gridRect, context)) {
+		return false;
+	}
+
+	if (!analyzeLocatedGrid(fullImage, planes.gray(), gridRect, layout, outCells, context, &planes)) {
+		return false;
+	}
+	if (outGeometry) {
+		*outGeometry = context.geometry;
+	}
+	saveFinalResult(fullImage, outCells);
+
+	return true;
+}
+
+bool analyzeGrid(FramePlanes& planes, vector<CellInfo>& outCells, const GridLayout& layout, RecognitionContext& context, GridGeometry* outGeometry) {
+	debugNextFrame();
+	return analyzeFrame(planes, outCells, layout, context, outGeometry);
+}
+
+GridTracker::GridTracker(const GridLayout& layout, const GridTrackerParams& params)
+	: m_layout(layout), m_params(params) {
+}
+
+void GridTracker::reset() {
+	m_locked = false;
+	m_gridRect = Rect();
+}
+
+// 网格外边框四条边上有边缘像素的比例（每条边取 ±2 像素的条带，条带内任一行/列有边缘即算覆盖）
+static double borderEdgeCoverage(const Mat& edges, const Rect& rect, Mat& profile) {
+	const int band = 2;
+	Rect frame(0, 0, edges.cols, edges.rows);
+	Rect strips[4] = {
+		Rect(rect.x, rect.y - band, rect.width, 2 * band + 1),
+		Rect(rect.x, rect.br().y - 1 - band, rect.width, 2 * band + 1),
+		Rect(rect.x - band, rect.y, 2 * band + 1, rect.height),
+		Rect(rect.br().x - 1 - band, rect.y, 2 * band + 1, rect.height),
+	};
+
+	double covered = 0, total = 0;
+	for (int i = 0; i < 4; i++) {
+		Rect strip = strips[i] & frame;
+		if (strip.empty()) {
+			continue;
+		}
+		// 水平边按列、竖直边按行取最大值
+		reduce(edges(strip), profile, i < 2 ? 0 : 1, REDUCE_MAX);
+		covered += countNonZero(profile);
+		total += i < 2 ? rect.width : rect.height;
+	}
+	return total > 0 ? covered / total : 0.0;
+}
+
+// 将 ROI 内的结果平移回整帧坐标
+static void offsetResults(vector<CellInfo>& cells, size_t first, GridGeometry& geometry, Point offset) {
+	for (size_t i = first; i < cells.size(); i++) {
+		cells[i].bounds += offset;
+		cells[i].center += Point2f(static_cast<float>(offset.x), static_cast<float>(offset.y));
+	}
+	geometry.bounds += offset;
+	for (int& x : geometry.colLines) {
+		x += offset.x;
+	}
+	for (int& y : geometry.rowLines) {
+		y += offset.y;
+	}
+}
+
+bool GridTracker::analyzeRoi(FramePlanes& planes, const Rect& expected, vector<CellInfo>& outCells) {
+	const Mat& fullImage = planes.frame();
+	Rect frame(0, 0, fullImage.cols, fullImage.rows);
+	int margin = std::max(4, cvRound(std::max(expected.width, expected.height) * m_params.marginRatio));
+	Rect roi = Rect(expected.x - margin, expected.y - margin, expected.width + 2 * margin, expected.height + 2 * margin) & frame;
+	if (roi.empty()) {
+		return false;
+	}
+
+	// 整帧边缘图已经算过时直接截取 ROI，否则只在 ROI 内转换灰度并检测边缘
+	Mat image = fullImage(roi);
+	Rect gridRect;
+	bool shared = planes.has(FramePlanes::EDGES);
+	bool located = shared ? locateGridFromEdges(image, planes.edges()(roi), gridRect, m_context) : locateGrid(image, gridRect, m_context);
+	if (!located) {
+		return false;
+	}
+
+	// 校验：尺寸与预期相近，且外边框上确实有连续的边缘
+	double widthRatio = static_cast<double>(gridRect.width) / expected.width;
+	double heightRatio = static_cast<double>(gridRect.height) / expected.height;
+	if (std::abs(widthRatio - 1.0) > m_params.maxSizeChange || std::abs(heightRatio - 1.0) > m_params.maxSizeChange) {
+		return false;
+	}
+	if (borderEdgeCoverage(m_context.morphed, gridRect, m_context.profile) < m_params.minEdgeCoverage) {
+		return false;
+	}
+
+	size_t first = outCells.size();
+	if (!analyzeLocatedGrid(image, shared ? planes.gray()(roi) : m_context.gray, gridRect, m_layout, outCells, m_context, &planes, roi.tl())) {
+		outCells.resize(first);
+		return false;
+	}
+	offsetResults(outCells, first, m_context.geometry, roi.tl());
+	return true;
+}
+
+bool GridTracker::reacquire(const Mat& fullImage, Rect& gridRect) {
+	SNOW_SCOPED_TIMER("GridTracker.reacquire");
+	int maxDim = std::max(fullImage.cols, fullImage.rows);
+	if (m_params.acquireMaxDim <= 0 || maxDim <= m_params.acquireMaxDim) {
+		return locateGrid(fullImage, gridRect, m_context);
+	}
+	m_reacquisitions++;
+
+	// 在缩小的帧上定位，再映射回全分辨率，由随后的 ROI 分析精确对齐
+	double scale = static_cast<double>(m_params.acquireMaxDim) / maxDim;
+	resize(fullImage, m_context.small, Size(), scale, scale, INTER_AREA);
+	Rect smallRect;
+	if (!locateGrid(m_context.small, smallRect, m_context)) {
+		return false;
+	}
+	gridRect = Rect(cvFloor(smallRect.x / scale), cvFloor(smallRect.y / scale), cvCeil(smallRect.width / scale), cvCeil(smallRect.height / scale));
+	gridRect &= Rect(0, 0, fullImage.cols, fullImage.rows);
+	return !gridRect.empty();
+}
+
+// 两个矩形各边的最大偏移
+static int rectShift(const Rect& a, const Rect& b) {
+	return std::max(std::max(std::abs(a.x - b.x), std::abs(a.y - b.y)), std::max(std::abs(a.br().x - b.br().x), std::abs(a.br().y - b.br().y)));
+}
+
+bool GridTracker::analyze(const Mat& fullImage, vector<CellInfo>& outCells, GridGeometry* outGeometry) {
+	m_context.planes.reset(fullImage);
+	bool ok = analyze(m_context.planes, outCells, outGeometry);
+	m_context.planes.clear();
+	return ok;
+}
+
+bool GridTracker::analyze(FramePlanes& planes, vector<CellInfo>& outCells, GridGeometry* outGeometry) {
+	debugNextFrame();
+	return track(planes, outCells, outGeometry);
+}
+
+bool GridTracker::track(FramePlanes& planes, vector<CellInfo>& outCells, GridGeometry* outGeometry) {
+	SNOW_SCOPED_TIMER("GridTracker.analyze");
+	const Mat& fullImage = planes.frame();
+	if (fullImage.empty()) {
+		cerr << "Invalid image" << endl;
+		return false;
+	}
+
+	bool tracked = m_locked && fullImage.size() == m_frameSize;
+	bool ok = tracked && analyzeRoi(planes, m_gridRect, outCells);
+	if (!ok) {
+		tracked = false;
+		Rect acquired;
+		ok = reacquire(fullImage, acquired) && analyzeRoi(planes, acquired, outCells);
+	}
+	if (ok) {
+		saveFinalResult(fullImage, outCells);
+	}
+	else {
+		// 缩小后定位失败或校验不通过时，退回整帧分析
+		m_fullAnalyses++;
+		size_t first = outCells.size();
+		ok = analyzeFrame(planes, outCells, m_layout, m_context, nullptr);
+		if (!ok) {
+			outCells.resize(first);
+			reset();
+			return false;
 		}
-		saveImages(outFinalResult, "9_final_result.jpg");
 	}
 
+	// 网格只有一两个像素的抖动时保持锁定区域不变，ROI 与缓冲区尺寸保持稳定
+	const Rect& bounds = m_context.geometry.bounds;
+	if (!tracked || rectShift(m_gridRect, bounds) > 2) {
+		m_gridRect = bounds;
+	}
+	m_locked = true;
+	m_frameSize = fullImage.size();
+	if (outGeometry) {
+		*outGeometry = m_context.geometry;
+	}
 	return true;
 }
 
+// 单元格签名：8x8 面积插值缩略图，对噪声不敏感且比较代价固定
+static void cellSignature(const Mat& cellRegion, Mat& signature) {
+	resize(cellRegion, signature, Size(8, 8), 0, 0, INTER_AREA);
+}
+
+// 签名的平均逐通道绝对差
+static double signatureDistance(const Mat& a, const Mat& b) {
+	if (a.empty() || b.empty() || a.size() != b.size() || a.type() != b.type()) {
+		return numeric_limits<double>::max();
+	}
+	return norm(a, b, NORM_L1) / static_cast<double>(a.total() * a.channels());
+}
+
+GridAnalyzer::GridAnalyzer(double changeThreshold, const GridLayout& layout)
+	: m_changeThreshold(changeThreshold), m_layout(layout), m_tracker(layout) {
+}
+
+void GridAnalyzer::reset() {
+	m_frameSize = Size();
+	m_gridRect = Rect();
+	m_tracker.reset();
+	m_geometry = GridGeometry();
+	m_cells.clear();
+	m_signatures.clear();
+	m_borderSignature.release();
+	m_lineSignature.release();
+	m_lastReclassified = 0;
+}
 
+// 网格边框附近的条带缩略图，用于廉价地判断网格是否移动或界面是否切换
+void GridAnalyzer::borderSignature(const Mat& fullImage, Mat& signature, Mat& thumb) const {
+	int band = std::max(4, std::min(m_gridRect.width, m_gridRect.height) / 20);
+	Rect frame(0, 0, fullImage.cols, fullImage.rows);
+	Rect strips[4] = {
+		Rect(m_gridRect.x - band, m_gridRect.y - band, m_gridRect.width + 2 * band, 2 * band),
+		Rect(m_gridRect.x - band, m_gridRect.br().y - band, m_gridRect.width + 2 * band, 2 * band),
+		Rect(m_gridRect.x - band, m_gridRect.y - band, 2 * band, m_gridRect.height + 2 * band),
+		Rect(m_gridRect.br().x - band, m_gridRect.y - band, 2 * band, m_gridRect.height + 2 * band),
+	};
+
+	signature.create(4, 32 * 4, CV_8UC3);
+	signature.setTo(Scalar::all(0));
+	for (int i = 0; i < 4; i++) {
+		Rect strip = strips[i] & frame;
+		if (strip.empty()) {
+			continue;
+		}
+		Size thumbSize = i < 2 ? Size(32, 4) : Size(4, 32);
+		resize(fullImage(strip), thumb, thumbSize, 0, 0, INTER_AREA);
+		thumb.reshape(0, 4).copyTo(signature(Rect(32 * i, 0, 32, 4)));
+	}
+}
+
+// 沿每条分界线的细条带缩略图；分界线的位置不变时条带内基本只有线本身，不受单元格内容影响
+void GridAnalyzer::lineSignature(const Mat& fullImage, Mat& signature, Mat& thumb) const {
+	const int samples = 16;
+	int radius = std::max(1, std::min(m_gridRect.width / std::max(1, m_geometry.cols()), m_gridRect.height / std::max(1, m_geometry.rows())) / 24);
+	Rect frame(0, 0, fullImage.cols, fullImage.rows);
+	const Rect& bounds = m_geometry.bounds;
+	size_t count = m_geometry.colLines.size() + m_geometry.rowLines.size();
+
+	signature.create(1, static_cast<int>(count) * samples, CV_8UC3);
+	signature.setTo(Scalar::all(0));
+	int index = 0;
+	for (int x : m_geometry.colLines) {
+		Rect strip = Rect(x - radius, bounds.y, 2 * radius + 1, bounds.height) & frame;
+		if (!strip.empty()) {
+			resize(fullImage(strip), thumb, Size(1, samples), 0, 0, INTER_AREA);
+			thumb.reshape(0, 1).copyTo(signature(Rect(index * samples, 0, samples, 1)));
+		}
+		index++;
+	}
+	for (int y : m_geometry.rowLines) {
+		Rect strip = Rect(bounds.x, y - radius, bounds.width, 2 * radius + 1) & frame;
+		if (!strip.empty()) {
+			resize(fullImage(strip), thumb, Size(samples, 1), 0, 0, INTER_AREA);
+			thumb.copyTo(signature(Rect(index * samples, 0, samples, 1)));
+		}
+		index++;
+	}
+}
+
+void GridAnalyzer::refreshSignatures(const Mat& fullImage) {
+	m_signatures.resize(m_cells.size());
+	for (size_t i = 0; i < m_cells.size(); i++) {
+		cellSignature(fullImage(m_cells[i].bounds), m_signatures[i]);
+	}
+	borderSignature(fullImage, m_borderSignature, m_thumb);
+	lineSignature(fullImage, m_lineSignature, m_thumb);
+}
+
+bool GridAnalyzer::analyze(const Mat& fullImage, vector<CellInfo>& outCells) {
+	m_planes.reset(fullImage);
+	bool ok = analyze(m_planes, outCells);
+	m_planes.clear();
+	return ok;
+}
+
+bool GridAnalyzer::analyze(FramePlanes& planes, vector<CellInfo>& outCells) {
+	SNOW_SCOPED_TIMER("GridAnalyzer.analyze");
+	const Mat& fullImage = planes.frame();
+	if (fullImage.empty()) {
+		cerr << "Invalid image" << endl;
+		return false;
+	}
+	debugNextFrame();
+
+	// 帧尺寸变化或网格边框变化时，需要检查几何是否仍然有效
+	bool cached = !m_cells.empty() && fullImage.size() == m_frameSize;
+	bool borderValid = cached;
+	if (cached) {
+		borderSignature(fullImage, m_scratchBorder, m_thumb);
+		borderValid = signatureDistance(m_scratchBorder, m_borderSignature) <= m_changeThreshold;
+	}
+
+	if (cached && !borderValid) {
+		// 边框附近有变化但分界线没有移动（如界面动画遮挡边框外侧）：沿用缓存的几何，重新分类全部单元格
+		lineSignature(fullImage, m_scratchLines, m_thumb);
+		if (signatureDistance(m_scratchLines, m_lineSignature) <= m_changeThreshold) {
+			// 全部单元格都要重新分类：整帧求一次积分图，每个单元格 O(1)
+			planes.integralSum();
+			for (auto& cell : m_cells) {
+				classifyCell(planes, cell.bounds, m_scratchGray, m_layout, cell);
+			}
+			refreshSignatures(fullImage);
+			m_lastReclassified = static_cast<int>(m_cells.size());
+
+			outCells.insert(outCells.end(), m_cells.begin(), m_cells.end());
+			return true;
+		}
+	}
+
+	if (!borderValid) {
+		vector<CellInfo> cells;
+		GridGeometry geometry;
+		m_geometryDetections++;
+		if (!m_tracker.track(planes, cells, &geometry)) {
+			reset();
+			return false;
+		}
+
+		m_frameSize = fullImage.size();
+		m_gridRect = Rect(cells.front().bounds.tl(), cells.back().bounds.br());
+		m_geometry = std::move(geometry);
+		m_cells = std::move(cells);
+		refreshSignatures(fullImage);
+		m_lastReclassified = static_cast<int>(m_cells.size());
+
+		outCells.insert(outCells.end(), m_cells.begin(), m_cells.end());
+		return true;
+	}
+
+	// 几何不变：只重新分类签名发生变化的单元格
+	m_lastReclassified = 0;
+	for (size_t i = 0; i < m_cells.size(); i++) {
+		Mat cellRegion = fullImage(m_cells[i].bounds);
+		cellSignature(cellRegion, m_scratchSignature);
+		if (signatureDistance(m_scratchSignature, m_signatures[i]) <= m_changeThreshold) {
+			continue;
+		}
+		classifyCell(planes, m_cells[i].bounds, m_scratchGray, m_layout, m_cells[i]);
+		m_scratchSignature.copyTo(m_signatures[i]);
+		m_lastReclassified++;
+	}
+	// 交换而不是赋值，两者各自保留缓冲区，下一帧不会覆盖刚保存的签名
+	swap(m_borderSignature, m_scratchBorder);
+
+	outCells.insert(outCells.end(), m_cells.begin(), m_cells.end());
+	return true;
+}
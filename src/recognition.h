@@ -1,5 +1,7 @@
 #pragma once
 
+#include "HistogramEngine.h"
+#include "FramePlanes.h"
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
@@ -16,13 +18,235 @@ struct CellInfo {
 	cv::Point2f center;
 	Status status;
 	cv::Rect bounds;
+	float brightness = 0; // 灰度均值
+	float contrast = 0;   // 灰度标准差
 };
 
+// 网格布局：行列数与分类阈值
+struct GridLayout {
+	int rows = 5;
+	int cols = 6;
+	double blockedBrightness = 200; // 灰度均值超过该值判为 BLOCKED
+	bool detectLines = true;        // 从边缘图检测行列分界线，检测失败时按 rows/cols 等分
+};
+
+/**
+ * @brief 网格几何
+ * 行/列分界线的绝对坐标（含外边框），rowLines.size() == rows + 1，colLines.size() == cols + 1
+ */
+struct GridGeometry {
+	cv::Rect bounds;
+	std::vector<int> rowLines;
+	std::vector<int> colLines;
+
+	int rows() const { return rowLines.empty() ? 0 : static_cast<int>(rowLines.size()) - 1; }
+	int cols() const { return colLines.empty() ? 0 : static_cast<int>(colLines.size()) - 1; }
+	bool empty() const { return rows() <= 0 || cols() <= 0; }
+	// 第 row 行第 col 列（从 0 开始）单元格的绝对矩形
+	cv::Rect cell(int row, int col) const {
+		return cv::Rect(colLines[col], rowLines[row], colLines[col + 1] - colLines[col], rowLines[row + 1] - rowLines[row]);
+	}
+
+	// 将 bounds 等分为 rows 行 cols 列
+	static GridGeometry uniform(const cv::Rect& bounds, int rows, int cols);
+};
+
+/**
+ * @brief 识别过程的可复用缓冲区
+ * 持有网格定位、分界线检测、单元格分类、模板匹配与直方图的全部中间结果、结构元素与轮廓存储。
+ * 跨帧复用同一个实例时，只要帧尺寸不变，这些缓冲区就不会重新分配。
+ * 同一实例不能在多个线程间同时使用。
+ */
+struct RecognitionContext {
+	RecognitionContext();
+
+	cv::Mat gray;
+	cv::Mat edges;
+	cv::Mat morphed;
+	cv::Mat kernel;                                // 3x3 矩形结构元素
+	std::vector<std::vector<cv::Point>> contours;
+	cv::Mat colProfile;                            // 分界线检测的投影曲线
+	cv::Mat rowProfile;
+	std::vector<int> peaks;
+	std::vector<int> colLines;
+	std::vector<int> rowLines;
+	std::vector<int> gaps;
+	GridGeometry geometry;                         // 最近一次分析使用的网格几何
+	cv::Mat integralSum;
+	cv::Mat integralSqSum;
+	cv::Mat small;                                 // 缩小后的帧
+	cv::Mat profile;
+	cv::Mat matchResult;
+	HsHistogram histogram;
+	cv::Mat hist;
+	FramePlanes planes;                            // 只传入帧的重载在此建立单帧缓存，返回前释放对帧的引用
+};
 
+/**
+ * @brief 由边缘图的投影曲线检测网格的行列分界线
+ * 网格线在其所在的行/列上贯穿整个网格，投影值远高于单元格内容的边缘；
+ * 间隙两侧的两条边线合并为一条分界线（取中点）。
+ * @param edges 整帧的二值边缘图
+ * @param gridRect 网格外边框
+ * @return 检测到的分界线数量与间距是否合理
+ */
+bool detectGridGeometry(const cv::Mat& edges, const cv::Rect& gridRect, GridGeometry& outGeometry);
+
+
+// HSV 色调-饱和度直方图（50x60，CV_32F，L1 归一化）
 cv::Mat Image2Hist(const cv::Mat& image);
+// 结果写入 context.hist 并返回其引用，下次调用时被覆盖
+const cv::Mat& Image2Hist(const cv::Mat& image, RecognitionContext& context);
+
+// 帧中 roi 区域的直方图；HSV 平面取自 planes，整帧只转换一次，同一帧的多个区域只做分箱。
+// 只统计单个裁剪时使用 Image2Hist(image, context)，避免转换整帧
+const cv::Mat& Image2Hist(FramePlanes& planes, const cv::Rect& roi, RecognitionContext& context);
 
+// 与直方图的 Bhattacharyya 距离；同一裁剪需要与多个模板比较时使用 HistogramBank
 double ImageHistCompare(const cv::Mat& image, const cv::Mat& hist);
 
 cv::Point TemplateMatch(const cv::Mat& image, const cv::Mat& templateImage);
+// 匹配结果图保存在 context 中复用；matchTemplate 内部的临时缓冲区仍会每次分配
+cv::Point TemplateMatch(const cv::Mat& image, const cv::Mat& templateImage, RecognitionContext& context);
+
+// 金字塔粗到细匹配参数
+struct PyramidMatchParams {
+	int levels = 3;           // 下采样层数，0 表示直接全分辨率匹配
+	int candidates = 3;       // 每层保留的候选位置数
+	int searchRadius = 3;     // 候选映射到下一层后的搜索半径（像素）
+	int minTemplateSize = 12; // 最顶层模板短边的下限，不足时自动减少层数
+};
+
+// 金字塔模式：先在缩小的图像上全图匹配，再逐层只在候选附近细化，返回值含义与 TemplateMatch 相同
+cv::Point TemplateMatch(const cv::Mat& image, const cv::Mat& templateImage, const PyramidMatchParams& params);
+// 图像金字塔取自 planes，同一帧匹配多个模板时只下采样一次
+cv::Point TemplateMatch(FramePlanes& planes, const cv::Mat& templateImage, const PyramidMatchParams& params);
+
+// 匹配位置及其得分
+struct MatchCandidate {
+	cv::Point location; // 左上角
+	double score;       // TM_CCOEFF_NORMED 得分
+};
+
+// 多模板 Top-K 匹配参数
+struct TopKMatchParams {
+	int topK = 8;             // 每个模板最多返回的位置数
+	double threshold = 0.8;   // 得分下限
+	double nmsOverlap = 0.3;  // 非极大值抑制的 IoU 上限
+};
+
+// 在线程池上并行匹配所有模板，每个模板返回经非极大值抑制、按得分降序的前 K 个位置
+std::vector<std::vector<MatchCandidate>> TemplateMatchTopK(const cv::Mat& image, const std::vector<cv::Mat>& templates, const TopKMatchParams& params = TopKMatchParams());
+
+bool analyzeGrid(const cv::Mat& fullImage, std::vector<CellInfo>& outCells);
+// 按 layout 划分网格（检测分界线或等分）；单元格的均值与方差由网格区域的积分图以 O(1) 求得
+// outGeometry 非空时输出本帧使用的网格几何
+bool analyzeGrid(const cv::Mat& fullImage, std::vector<CellInfo>& outCells, const GridLayout& layout, GridGeometry* outGeometry = nullptr);
+// 复用 context 中的缓冲区；outCells 复用时先 clear()，帧尺寸不变时识别代码本身不再分配内存，
+// 但 Canny、findContours 等 OpenCV 原语内部每次调用仍会分配临时缓冲区（ProjectSnowBench --check-allocs 检查）
+bool analyzeGrid(const cv::Mat& fullImage, std::vector<CellInfo>& outCells, RecognitionContext& context);
+bool analyzeGrid(const cv::Mat& fullImage, std::vector<CellInfo>& outCells, const GridLayout& layout, RecognitionContext& context, GridGeometry* outGeometry = nullptr);
+// 灰度图与边缘图取自 planes；planes 已有整帧积分图时单元格统计直接使用，否则只对网格区域求积分图
+bool analyzeGrid(FramePlanes& planes, std::vector<CellInfo>& outCells, const GridLayout& layout, RecognitionContext& context, GridGeometry* outGeometry = nullptr);
+
+// 网格跟踪参数
+struct GridTrackerParams {
+	double marginRatio = 0.05;     // ROI 在网格外边框四周扩展的比例（相对网格长边）
+	double maxSizeChange = 0.1;    // ROI 内重新定位的网格尺寸与上一帧的最大相对变化
+	double minEdgeCoverage = 0.6;  // 外边框上边缘像素覆盖比例的下限
+	int acquireMaxDim = 960;       // 重新捕获时把帧缩小到长边不超过该值，0 表示不缩小
+};
+
+/**
+ * @brief 网格锁定跟踪
+ * 找到网格后，之后的帧只在上一帧网格外边框加少量边距的 ROI 内定位与分析，
+ * 并检查外边框尺寸和边缘覆盖率；校验失败时先在缩小的整帧上重新捕获网格，
+ * 映射回全分辨率后再做 ROI 分析，仍失败才退回整帧 analyzeGrid。
+ */
+class GridTracker {
+public:
+	explicit GridTracker(const GridLayout& layout = GridLayout(), const GridTrackerParams& params = GridTrackerParams());
+
+	// 与 analyzeGrid 含义相同，结果追加到 outCells，坐标均为整帧坐标
+	bool analyze(const cv::Mat& fullImage, std::vector<CellInfo>& outCells, GridGeometry* outGeometry = nullptr);
+	// planes 中已有的灰度图、边缘图与积分图在 ROI 分析时直接取用
+	bool analyze(FramePlanes& planes, std::vector<CellInfo>& outCells, GridGeometry* outGeometry = nullptr);
+	// 解除锁定，下一帧重新捕获
+	void reset();
+
+	bool locked() const { return m_locked; }
+	const cv::Rect& gridRect() const { return m_gridRect; }
+	// 重新捕获（缩小帧定位）的累计次数
+	int reacquisitions() const { return m_reacquisitions; }
+	// 退回整帧分析的累计次数
+	int fullAnalyses() const { return m_fullAnalyses; }
+
+private:
+	friend class GridAnalyzer;
 
-bool analyzeGrid(const cv::Mat& fullImage, std::vector<CellInfo>& outCells);
\ No newline at end of file
+	// analyze 的实现，不推进调试采样的帧计数；GridAnalyzer 需要重新定位时直接调用
+	bool track(FramePlanes& planes, std::vector<CellInfo>& outCells, GridGeometry* outGeometry);
+	bool analyzeRoi(FramePlanes& planes, const cv::Rect& expected, std::vector<CellInfo>& outCells);
+	bool reacquire(const cv::Mat& fullImage, cv::Rect& gridRect);
+
+	GridLayout m_layout;
+	GridTrackerParams m_params;
+	RecognitionContext m_context;
+	bool m_locked = false;
+	cv::Size m_frameSize;
+	cv::Rect m_gridRect;
+	int m_reacquisitions = 0;
+	int m_fullAnalyses = 0;
+};
+
+/**
+ * @brief 增量网格分析器
+ * 保存上一帧的网格几何与每个单元格的缩略图签名，
+ * 新帧只对签名发生变化的单元格重新分类，其余直接返回缓存的 CellInfo。
+ * 网格边框附近的图像发生变化时，先比较沿各条分界线的条带签名：
+ * 分界线未移动则沿用缓存的几何重新分类全部单元格，否则才由 GridTracker 重新定位网格并检测分界线。
+ */
+class GridAnalyzer {
+public:
+	// changeThreshold: 签名平均逐像素绝对差超过该值视为发生变化
+	explicit GridAnalyzer(double changeThreshold = 4.0, const GridLayout& layout = GridLayout());
+
+	// 与 analyzeGrid 含义相同，结果追加到 outCells
+	bool analyze(const cv::Mat& fullImage, std::vector<CellInfo>& outCells);
+	// 单元格重新分类时使用 planes 中已有的积分图或灰度图，全部重新分类时整帧只求一次积分图
+	bool analyze(FramePlanes& planes, std::vector<CellInfo>& outCells);
+	// 丢弃缓存，下一帧完整分析
+	void reset();
+
+	// 上一帧重新分类的单元格数
+	int lastReclassified() const { return m_lastReclassified; }
+	// 重新定位网格并检测分界线的累计次数
+	int geometryDetections() const { return m_geometryDetections; }
+	const GridGeometry& geometry() const { return m_geometry; }
+
+private:
+	void borderSignature(const cv::Mat& fullImage, cv::Mat& signature, cv::Mat& thumb) const;
+	void lineSignature(const cv::Mat& fullImage, cv::Mat& signature, cv::Mat& thumb) const;
+	void refreshSignatures(const cv::Mat& fullImage);
+
+	double m_changeThreshold;
+	GridLayout m_layout;
+	GridTracker m_tracker;
+	cv::Size m_frameSize;
+	cv::Rect m_gridRect;
+	GridGeometry m_geometry;
+	std::vector<CellInfo> m_cells;
+	std::vector<cv::Mat> m_signatures;
+	cv::Mat m_borderSignature;
+	cv::Mat m_lineSignature;
+	int m_lastReclassified = 0;
+	int m_geometryDetections = 0;
+
+	// 跨帧复用的临时缓冲区
+	FramePlanes m_planes;
+	cv::Mat m_thumb;
+	cv::Mat m_scratchSignature;
+	cv::Mat m_scratchGray;
+	cv::Mat m_scratchBorder;
+	cv::Mat m_scratchLines;
+};
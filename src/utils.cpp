@@ -1,30 +1,201 @@
 ﻿#include "utils.h"
 #include <iostream>
 #include <filesystem>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 using namespace std;
 using namespace std::filesystem;
 
 bool g_debug = false;
 
-void saveImage(const cv::Mat& image, const std::string& filename, const std::string& rootPath) {
-	if (!g_debug || image.empty()) return;
+/**
+ * 调试图像后台写入器
+ * 调用线程只负责把 Mat 放入有界队列，目录创建与 imwrite 编码都在后台线程完成。
+ */
+class DebugImageWriter {
+public:
+	static DebugImageWriter& instance() {
+		static DebugImageWriter writer;
+		return writer;
+	}
+
+	~DebugImageWriter() {
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wakeWriter.notify_all();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+	}
+
+	void configure(const DebugWriterConfig& config) {
+		lock_guard<mutex> lock(m_mutex);
+		m_config = config;
+		if (m_config.queueCapacity == 0) {
+			m_config.queueCapacity = 1;
+		}
+		if (m_config.sampleEveryN < 1) {
+			m_config.sampleEveryN = 1;
+		}
+		m_sampleEveryN.store(m_config.sampleEveryN);
+	}
+
+	void nextFrame() {
+		m_frame.fetch_add(1, memory_order_relaxed);
+	}
+
+	// 本帧是否需要保存
+	bool sampled() const {
+		return m_frame.load(memory_order_relaxed) % static_cast<uint64_t>(m_sampleEveryN.load(memory_order_relaxed)) == 0;
+	}
+
+	// 在队列中预留一个位置；队列已满时计入丢弃并返回 false，调用方不必再拷贝图像
+	bool reserve() {
+		lock_guard<mutex> lock(m_mutex);
+		if (!m_thread.joinable()) {
+			m_thread = thread(&DebugImageWriter::run, this);
+		}
+		if (m_queue.size() + m_reserved >= m_config.queueCapacity) {
+			m_dropped.fetch_add(1, memory_order_relaxed);
+			return false;
+		}
+		m_reserved++;
+		return true;
+	}
+
+	// 放入已预留位置的图像（拷贝在锁外完成）
+	void commit(cv::Mat&& image, path full) {
+		unique_lock<mutex> lock(m_mutex);
+		m_reserved--;
+		m_queue.push_back({ std::move(image), std::move(full) });
+		lock.unlock();
+		m_wakeWriter.notify_one();
+	}
+
+	void flush() {
+		unique_lock<mutex> lock(m_mutex);
+		m_wakeProducer.wait(lock, [this]() { return m_queue.empty() && m_reserved == 0 && !m_writing; });
+	}
+
+	uint64_t dropped() const {
+		return m_dropped.load();
+	}
 
+private:
+	struct Job {
+		cv::Mat image;
+		path full;
+	};
+
+	DebugImageWriter() = default;
+
+	void run() {
+		unordered_set<string> createdDirs;
+		unique_lock<mutex> lock(m_mutex);
+		while (true) {
+			m_wakeWriter.wait(lock, [this]() { return !m_queue.empty() || m_stopping; });
+			if (m_queue.empty()) {
+				break;
+			}
+			Job job = std::move(m_queue.front());
+			m_queue.pop_front();
+			vector<int> params = m_config.imwriteParams;
+			m_writing = true;
+			lock.unlock();
+			m_wakeProducer.notify_all();
+
+			// 每个目录只创建一次
+			string dir = job.full.parent_path().string();
+			if (createdDirs.insert(dir).second) {
+				error_code ec;
+				create_directories(job.full.parent_path(), ec);
+				if (ec) {
+					cerr << "failed to create directories: " << dir << ", error: " << ec.message() << endl;
+				}
+			}
+
+			bool ok = cv::imwrite(job.full.string(), job.image, params);
+			if (ok) {
+				cout << "save image: " << job.full.string() << endl;
+			}
+			else {
+				cerr << "failed to save image: " << job.full.string() << endl;
+			}
+
+			lock.lock();
+			m_writing = false;
+			m_wakeProducer.notify_all();
+		}
+	}
+
+	mutex m_mutex;
+	condition_variable m_wakeWriter;
+	condition_variable m_wakeProducer;
+	deque<Job> m_queue;
+	size_t m_reserved = 0;  // 已预留、尚未放入队列的位置
+	DebugWriterConfig m_config;
+	thread m_thread;
+	bool m_stopping = false;
+	bool m_writing = false;
+	atomic<uint64_t> m_frame{ 0 };
+	atomic<int> m_sampleEveryN{ 1 };
+	atomic<uint64_t> m_dropped{ 0 };
+};
+
+static path debugImagePath(const std::string& filename, const std::string& rootPath) {
 	path basePath = path("./logs/images");
 	path root = path(rootPath);
-	path full = (basePath / root / filename).lexically_normal();
+	return (basePath / root / filename).lexically_normal();
+}
 
-	error_code ec;
-	create_directories(full.parent_path(), ec);
-	if (ec) {
-		cerr << "failed to create directories: " << full.parent_path().string() << ", error: " << ec.message() << endl;
+void saveImage(const cv::Mat& image, const std::string& filename, const std::string& rootPath) {
+	if (!g_debug || image.empty() || !DebugImageWriter::instance().sampled()) return;
+
+	// 调用方之后可能修改或复用该缓冲区，必须拷贝；队列已满时不拷贝
+	DebugImageWriter& writer = DebugImageWriter::instance();
+	if (writer.reserve()) {
+		writer.commit(image.clone(), debugImagePath(filename, rootPath));
 	}
+}
+
+void saveImage(cv::Mat&& image, const std::string& filename, const std::string& rootPath) {
+	if (!g_debug || image.empty() || !DebugImageWriter::instance().sampled()) return;
 
-	bool ok = cv::imwrite(full.string(), image);
-	if (ok) {
-		cout << "save image: " << full.string() << endl;
+	DebugImageWriter& writer = DebugImageWriter::instance();
+	if (writer.reserve()) {
+		writer.commit(std::move(image), debugImagePath(filename, rootPath));
 	}
-	else {
-		cerr << "failed to save image: " << full.string() << endl;
+}
+
+void saveImageShared(const cv::Mat& image, const std::string& filename, const std::string& rootPath) {
+	if (!g_debug || image.empty() || !DebugImageWriter::instance().sampled()) return;
+
+	// 共享引用计数；外部数据（如捕获会话缓冲区上的视图）没有所有者，只能拷贝
+	DebugImageWriter& writer = DebugImageWriter::instance();
+	if (writer.reserve()) {
+		writer.commit(image.u ? cv::Mat(image) : image.clone(), debugImagePath(filename, rootPath));
 	}
-}
\ No newline at end of file
+}
+
+void configureDebugWriter(const DebugWriterConfig& config) {
+	DebugImageWriter::instance().configure(config);
+}
+
+void debugNextFrame() {
+	DebugImageWriter::instance().nextFrame();
+}
+
+void flushDebugImages() {
+	DebugImageWriter::instance().flush();
+}
+
+uint64_t debugImagesDropped() {
+	return DebugImageWriter::instance().dropped();
+}
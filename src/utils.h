@@ -1,10 +1,33 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 
 
 // 全局调试开关
 extern bool g_debug;
 // only save when debug is true, rootPath default is current directory
-void saveImage(const cv::Mat& image, const std::string& filename, const std::string& rootPath = "");
\ No newline at end of file
+void saveImage(const cv::Mat& image, const std::string& filename, const std::string& rootPath = "");
+// 接管 image 的所有权，入队时不做深拷贝
+void saveImage(cv::Mat&& image, const std::string& filename, const std::string& rootPath = "");
+// 与调用方共享 image 的引用计数缓冲区，入队时不做深拷贝（没有引用计数的外部数据仍会拷贝）；
+// 写入完成前调用方不能原地改写该缓冲区，需要复用时先检查引用计数并改用新缓冲区
+void saveImageShared(const cv::Mat& image, const std::string& filename, const std::string& rootPath = "");
+
+// 调试图像后台写入配置
+// 保存调试图像的线程从不等待后台写入：队列满时直接丢弃新图像（先检查容量，丢弃的图像不会被拷贝），计入 debugImagesDropped
+struct DebugWriterConfig {
+	size_t queueCapacity = 256;      // 后台写入队列容量
+	int sampleEveryN = 1;            // 每 N 帧保存一帧的调试图像
+	std::vector<int> imwriteParams;  // 编码参数，如 { cv::IMWRITE_JPEG_QUALITY, 80 }
+};
+
+void configureDebugWriter(const DebugWriterConfig& config);
+// 标记新一帧开始，按 sampleEveryN 决定本帧的调试图像是否保存
+void debugNextFrame();
+// 等待已入队的调试图像全部写入磁盘
+void flushDebugImages();
+// 因队列满被丢弃的调试图像数
+uint64_t debugImagesDropped();